@@ -1,14 +1,24 @@
 #include "Canvas.h"
 #include <algorithm>
-#include <cmath>
+#include <cstring>
 
 Canvas::Canvas(int x, int y, int width, int height)
     : Widget(x, y, width, height),
       backgroundColor(0xFFFFFFFF),
       borderColor(0xFF808080),
       drawCallback(nullptr),
+      stridedDrawCallback(nullptr),
       mouseCallback(nullptr),
-      mousePressed(false) {
+      mousePressed(false),
+      directRendering(false),
+      resizeSettling(false),
+      tripleBuffered(false),
+      swapBuffers{},
+      backIndex(0),
+      frontIndex(0),
+      publishedIndex(0),
+      requestedSize(0),
+      dirty(true) {
 
     // Account for border (1px on each side)
     canvasWidth = width - 2;
@@ -17,12 +27,19 @@ Canvas::Canvas(int x, int y, int width, int height)
     if (canvasWidth < 1) canvasWidth = 1;
     if (canvasHeight < 1) canvasHeight = 1;
 
-    canvasBuffer = new uint32_t[canvasWidth * canvasHeight];
+    backingCapacity = (size_t)canvasWidth * canvasHeight;
+    backingBuffer = new uint32_t[backingCapacity];
+    surface.setTarget(backingBuffer, canvasWidth, canvasHeight, canvasWidth);
+    dirtyLeft = 0;
+    dirtyTop = 0;
+    dirtyRight = canvasWidth;
+    dirtyBottom = canvasHeight;
     clear(backgroundColor);
 }
 
 Canvas::~Canvas() {
-    delete[] canvasBuffer;
+    setTripleBuffered(false);
+    delete[] backingBuffer;
 }
 
 void Canvas::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
@@ -32,40 +49,102 @@ void Canvas::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
     int endY = std::min(absY + height, bufferHeight);
 
     // Draw border
-    for (int py = absY; py < endY; py++) {
-        for (int px = absX; px < endX; px++) {
-            if (px >= 0 && py >= 0) {
-                if (py == absY || py == endY - 1 || px == absX || px == endX - 1) {
-                    buffer[py * bufferWidth + px] = borderColor;
-                }
-            }
+    int borderStartX = std::max(absX, 0);
+    if (borderStartX < endX) {
+        if (absY >= 0 && absY < endY) {
+            std::fill_n(buffer + absY * bufferWidth + borderStartX, endX - borderStartX, borderColor);
+        }
+        if (endY - 1 >= 0 && endY - 1 > absY) {
+            std::fill_n(buffer + (endY - 1) * bufferWidth + borderStartX, endX - borderStartX, borderColor);
         }
     }
-
-    // Call user draw callback if set
-    if (drawCallback) {
-        drawCallback(this, canvasBuffer, canvasWidth, canvasHeight);
+    for (int py = std::max(absY, 0); py < endY; py++) {
+        if (absX >= 0 && absX < endX) buffer[py * bufferWidth + absX] = borderColor;
+        if (endX - 1 >= 0 && endX - 1 > absX) buffer[py * bufferWidth + endX - 1] = borderColor;
     }
 
-    // Copy canvas buffer to screen buffer (accounting for border offset)
     int contentStartX = absX + 1;
     int contentStartY = absY + 1;
-    int contentEndX = std::min(contentStartX + canvasWidth, bufferWidth);
-    int contentEndY = std::min(contentStartY + canvasHeight, bufferHeight);
-
-    for (int py = contentStartY; py < contentEndY; py++) {
-        for (int px = contentStartX; px < contentEndX; px++) {
-            if (px >= 0 && py >= 0) {
-                int canvasX = px - contentStartX;
-                int canvasY = py - contentStartY;
-                if (canvasX >= 0 && canvasX < canvasWidth && canvasY >= 0 && canvasY < canvasHeight) {
-                    buffer[py * bufferWidth + px] = canvasBuffer[canvasY * canvasWidth + canvasX];
-                }
-            }
+
+    // Take the newest published frame, if any, and present it
+    if (tripleBuffered) {
+        if (publishedIndex.load(std::memory_order_acquire) & FRESH_FRAME) {
+            frontIndex = publishedIndex.exchange(frontIndex, std::memory_order_acq_rel) & ~FRESH_FRAME;
+        }
+        const SwapBuffer& front = swapBuffers[frontIndex];
+        blitContent(front.pixels, front.width, front.width, front.height, buffer, bufferWidth, bufferHeight,
+                    contentStartX, contentStartY);
+        return;
+    }
+
+    // Render straight into the window buffer when the whole canvas is visible
+    if (directRendering && stridedDrawCallback &&
+        contentStartX >= 0 && contentStartY >= 0 &&
+        contentStartX + canvasWidth <= bufferWidth && contentStartY + canvasHeight <= bufferHeight) {
+        surface.setTarget(buffer + contentStartY * bufferWidth + contentStartX, canvasWidth, canvasHeight, bufferWidth);
+        invalidate();
+        runDrawCallback();
+        surface.setTarget(backingBuffer, canvasWidth, canvasHeight, canvasWidth);
+
+        // The backing buffer did not receive this frame
+        invalidate();
+        return;
+    }
+
+    // Hold the callback back until a run of setSize calls has settled
+    if (resizeSettling && std::chrono::steady_clock::now() - resizeTime >= std::chrono::milliseconds(RESIZE_SETTLE_MS)) {
+        resizeSettling = false;
+        invalidate();
+    }
+
+    if (dirty && !resizeSettling) {
+        runDrawCallback();
+    }
+
+    blitContent(backingBuffer, canvasWidth, canvasWidth, canvasHeight, buffer, bufferWidth, bufferHeight,
+                contentStartX, contentStartY);
+}
+
+void Canvas::blitContent(const uint32_t* source, int sourceStride, int sourceWidth, int sourceHeight,
+                         uint32_t* buffer, int bufferWidth, int bufferHeight, int contentStartX, int contentStartY) {
+    // Copy canvas buffer to screen buffer (accounting for border offset)
+    int copyStartX = std::max(contentStartX, 0);
+    int copyStartY = std::max(contentStartY, 0);
+    int copyEndX = std::min(contentStartX + canvasWidth, bufferWidth);
+    int copyEndY = std::min(contentStartY + canvasHeight, bufferHeight);
+    if (copyStartX >= copyEndX) return;
+
+    // A source smaller than the canvas (a frame produced before a resize) is padded with the background
+    int sourceEndX = std::min(contentStartX + sourceWidth, copyEndX);
+    int sourceEndY = std::min(contentStartY + sourceHeight, copyEndY);
+    int rowPixels = std::max(sourceEndX - copyStartX, 0);
+    const uint32_t* src = source + (copyStartY - contentStartY) * sourceStride + (copyStartX - contentStartX);
+    for (int py = copyStartY; py < copyEndY; py++) {
+        uint32_t* dst = buffer + py * bufferWidth + copyStartX;
+        if (py < sourceEndY) {
+            std::memcpy(dst, src, rowPixels * sizeof(uint32_t));
+            std::fill(dst + rowPixels, buffer + py * bufferWidth + copyEndX, backgroundColor);
+            src += sourceStride;
+        } else {
+            std::fill(dst, buffer + py * bufferWidth + copyEndX, backgroundColor);
         }
     }
 }
 
+void Canvas::runDrawCallback() {
+    // Let the user callback regenerate the dirty region, with primitives clipped to it
+    dirty = false;
+    if (!drawCallback && !stridedDrawCallback) return;
+
+    surface.setClip(dirtyLeft, dirtyTop, dirtyRight - 1, dirtyBottom - 1);
+    if (stridedDrawCallback) {
+        stridedDrawCallback(this, surface.getBuffer(), canvasWidth, canvasHeight, surface.getStride());
+    } else {
+        drawCallback(this, surface.getBuffer(), canvasWidth, canvasHeight);
+    }
+    surface.resetClip();
+}
+
 void Canvas::handleMouseButton(int mouseX, int mouseY, bool isPressed) {
     int absX = getAbsoluteX();
     int absY = getAbsoluteY();
@@ -98,134 +177,192 @@ void Canvas::handleMouseMove(int mouseX, int mouseY) {
     }
 }
 
-void Canvas::setPixel(int x, int y, uint32_t color) {
-    if (x >= 0 && x < canvasWidth && y >= 0 && y < canvasHeight) {
-        canvasBuffer[y * canvasWidth + x] = color;
-    }
+void Canvas::invalidate() {
+    dirty = true;
+    dirtyLeft = 0;
+    dirtyTop = 0;
+    dirtyRight = canvasWidth;
+    dirtyBottom = canvasHeight;
 }
 
-void Canvas::drawLine(int x1, int y1, int x2, int y2, uint32_t color) {
-    // Bresenham's line algorithm
-    int dx = abs(x2 - x1);
-    int dy = abs(y2 - y1);
-    int sx = (x1 < x2) ? 1 : -1;
-    int sy = (y1 < y2) ? 1 : -1;
-    int err = dx - dy;
-
-    while (true) {
-        setPixel(x1, y1, color);
-
-        if (x1 == x2 && y1 == y2) break;
-
-        int e2 = 2 * err;
-        if (e2 > -dy) {
-            err -= dy;
-            x1 += sx;
-        }
-        if (e2 < dx) {
-            err += dx;
-            y1 += sy;
-        }
+void Canvas::invalidateRect(int x, int y, int w, int h) {
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + w, canvasWidth);
+    int bottom = std::min(y + h, canvasHeight);
+    if (left >= right || top >= bottom) return;
+
+    if (dirty) {
+        dirtyLeft = std::min(dirtyLeft, left);
+        dirtyTop = std::min(dirtyTop, top);
+        dirtyRight = std::max(dirtyRight, right);
+        dirtyBottom = std::max(dirtyBottom, bottom);
+    } else {
+        dirty = true;
+        dirtyLeft = left;
+        dirtyTop = top;
+        dirtyRight = right;
+        dirtyBottom = bottom;
     }
 }
 
-void Canvas::drawRect(int x, int y, int w, int h, uint32_t color) {
-    // Top and bottom edges
-    for (int px = x; px < x + w; px++) {
-        setPixel(px, y, color);
-        setPixel(px, y + h - 1, color);
-    }
-
-    // Left and right edges
-    for (int py = y; py < y + h; py++) {
-        setPixel(x, py, color);
-        setPixel(x + w - 1, py, color);
-    }
+void Canvas::getDirtyRect(int& x, int& y, int& w, int& h) const {
+    x = dirtyLeft;
+    y = dirtyTop;
+    w = dirtyRight - dirtyLeft;
+    h = dirtyBottom - dirtyTop;
 }
 
-void Canvas::fillRect(int x, int y, int w, int h, uint32_t color) {
-    int endX = std::min(x + w, canvasWidth);
-    int endY = std::min(y + h, canvasHeight);
-    int startX = std::max(x, 0);
-    int startY = std::max(y, 0);
+void Canvas::setDrawCallback(std::function<void(Canvas*, uint32_t*, int, int)> callback) {
+    drawCallback = callback;
+    stridedDrawCallback = nullptr;
+    invalidate();
+}
 
-    for (int py = startY; py < endY; py++) {
-        for (int px = startX; px < endX; px++) {
-            canvasBuffer[py * canvasWidth + px] = color;
-        }
-    }
+void Canvas::setStridedDrawCallback(std::function<void(Canvas*, uint32_t*, int, int, int)> callback) {
+    stridedDrawCallback = callback;
+    drawCallback = nullptr;
+    invalidate();
 }
 
-void Canvas::drawCircle(int centerX, int centerY, int radius, uint32_t color) {
-    // Midpoint circle algorithm
-    int x = radius;
-    int y = 0;
-    int err = 0;
+void Canvas::setMouseCallback(std::function<void(int, int, bool)> callback) {
+    mouseCallback = callback;
+}
 
-    while (x >= y) {
-        setPixel(centerX + x, centerY + y, color);
-        setPixel(centerX + y, centerY + x, color);
-        setPixel(centerX - y, centerY + x, color);
-        setPixel(centerX - x, centerY + y, color);
-        setPixel(centerX - x, centerY - y, color);
-        setPixel(centerX - y, centerY - x, color);
-        setPixel(centerX + y, centerY - x, color);
-        setPixel(centerX + x, centerY - y, color);
+void Canvas::setBackgroundColor(uint32_t color) {
+    backgroundColor = color;
+}
 
-        if (err <= 0) {
-            y += 1;
-            err += 2 * y + 1;
+void Canvas::setSize(int newWidth, int newHeight) {
+    Widget::setSize(newWidth, newHeight);
+
+    int newCanvasWidth = std::max(newWidth - 2, 1);
+    int newCanvasHeight = std::max(newHeight - 2, 1);
+    if (newCanvasWidth == canvasWidth && newCanvasHeight == canvasHeight) return;
+
+    // A producer keeps drawing into its own back buffer and resizes it on its next acquire
+    requestedSize.store((uint64_t)newCanvasWidth << 32 | (uint32_t)newCanvasHeight, std::memory_order_release);
+
+    // The backing buffer keeps rows canvasWidth pixels apart. Its allocation grows by half
+    // again when it overflows, so a splitter drag reallocates a handful of times; within
+    // capacity the kept rows are only moved to the new row pitch.
+    int keepWidth = std::min(canvasWidth, newCanvasWidth);
+    int keepHeight = std::min(canvasHeight, newCanvasHeight);
+    size_t needed = (size_t)newCanvasWidth * newCanvasHeight;
+    if (needed > backingCapacity) {
+        size_t newCapacity = std::max(needed, backingCapacity * 3 / 2);
+        uint32_t* newBuffer = new uint32_t[newCapacity];
+        for (int y = 0; y < keepHeight; y++) {
+            std::memcpy(newBuffer + y * newCanvasWidth, backingBuffer + y * canvasWidth, keepWidth * sizeof(uint32_t));
         }
-        if (err > 0) {
-            x -= 1;
-            err -= 2 * x + 1;
+        delete[] backingBuffer;
+        backingBuffer = newBuffer;
+        backingCapacity = newCapacity;
+    } else if (newCanvasWidth < canvasWidth) {
+        // Rows move towards the start, so walking down never overwrites a row before it moves
+        for (int y = 1; y < keepHeight; y++) {
+            std::memmove(backingBuffer + y * newCanvasWidth, backingBuffer + y * canvasWidth,
+                         keepWidth * sizeof(uint32_t));
         }
+    } else if (newCanvasWidth > canvasWidth) {
+        for (int y = keepHeight - 1; y > 0; y--) {
+            std::memmove(backingBuffer + y * newCanvasWidth, backingBuffer + y * canvasWidth,
+                         keepWidth * sizeof(uint32_t));
+        }
+    }
+
+    // Content stays anchored to the top-left; newly exposed pixels get the background
+    int oldWidth = canvasWidth;
+    int oldHeight = canvasHeight;
+    canvasWidth = newCanvasWidth;
+    canvasHeight = newCanvasHeight;
+    surface.setTarget(backingBuffer, canvasWidth, canvasHeight, canvasWidth);
+    if (canvasWidth > oldWidth) {
+        fillRect(oldWidth, 0, canvasWidth - oldWidth, std::min(oldHeight, canvasHeight), backgroundColor);
     }
+    if (canvasHeight > oldHeight) {
+        fillRect(0, oldHeight, canvasWidth, canvasHeight - oldHeight, backgroundColor);
+    }
+
+    dirtyRight = std::min(dirtyRight, canvasWidth);
+    dirtyBottom = std::min(dirtyBottom, canvasHeight);
+    if (dirtyLeft >= dirtyRight || dirtyTop >= dirtyBottom) {
+        invalidate();
+    }
+
+    resizeSettling = true;
+    resizeTime = std::chrono::steady_clock::now();
 }
 
-void Canvas::fillCircle(int centerX, int centerY, int radius, uint32_t color) {
-    int x = radius;
-    int y = 0;
-    int err = 0;
+void Canvas::setDirectRendering(bool enabled) {
+    if (directRendering == enabled) return;
+    directRendering = enabled;
+    invalidate();
+}
 
-    while (x >= y) {
-        // Draw horizontal lines to fill the circle
-        for (int px = centerX - x; px <= centerX + x; px++) {
-            setPixel(px, centerY + y, color);
-            setPixel(px, centerY - y, color);
+void Canvas::setTripleBuffered(bool enabled) {
+    if (tripleBuffered == enabled) return;
+
+    if (enabled) {
+        for (int i = 0; i < 3; i++) {
+            swapBuffers[i].pixels = new uint32_t[canvasWidth * canvasHeight];
+            swapBuffers[i].width = canvasWidth;
+            swapBuffers[i].height = canvasHeight;
+            for (int y = 0; y < canvasHeight; y++) {
+                std::memcpy(swapBuffers[i].pixels + y * canvasWidth, backingBuffer + y * canvasWidth,
+                            canvasWidth * sizeof(uint32_t));
+            }
         }
-        for (int px = centerX - y; px <= centerX + y; px++) {
-            setPixel(px, centerY + x, color);
-            setPixel(px, centerY - x, color);
+        frontIndex = 0;
+        publishedIndex.store(1);
+        backIndex = 2;
+        requestedSize.store((uint64_t)canvasWidth << 32 | (uint32_t)canvasHeight);
+        tripleBuffered = true;
+    } else {
+        // Keep the newest frame as the canvas content, including one not yet presented
+        if (publishedIndex.load(std::memory_order_acquire) & FRESH_FRAME) {
+            frontIndex = publishedIndex.exchange(frontIndex, std::memory_order_acq_rel) & ~FRESH_FRAME;
         }
-
-        if (err <= 0) {
-            y += 1;
-            err += 2 * y + 1;
+        const SwapBuffer& front = swapBuffers[frontIndex];
+        int keepWidth = std::min(front.width, canvasWidth);
+        int keepHeight = std::min(front.height, canvasHeight);
+        for (int y = 0; y < keepHeight; y++) {
+            std::memcpy(backingBuffer + y * canvasWidth, front.pixels + y * front.width,
+                        keepWidth * sizeof(uint32_t));
         }
-        if (err > 0) {
-            x -= 1;
-            err -= 2 * x + 1;
+        for (int i = 0; i < 3; i++) {
+            delete[] swapBuffers[i].pixels;
+            swapBuffers[i] = SwapBuffer{};
         }
+        tripleBuffered = false;
+        invalidate();
     }
 }
 
-void Canvas::clear(uint32_t color) {
-    for (int i = 0; i < canvasWidth * canvasHeight; i++) {
-        canvasBuffer[i] = color;
+CanvasSurface* Canvas::acquireBackBuffer() {
+    if (!tripleBuffered) return &surface;
+
+    // Only the producer touches the back buffer, so it can reallocate it to follow setSize
+    uint64_t size = requestedSize.load(std::memory_order_acquire);
+    int newWidth = (int)(size >> 32);
+    int newHeight = (int)(size & 0xFFFFFFFF);
+    SwapBuffer& back = swapBuffers[backIndex];
+    if (back.width != newWidth || back.height != newHeight) {
+        delete[] back.pixels;
+        back.pixels = new uint32_t[newWidth * newHeight]();
+        back.width = newWidth;
+        back.height = newHeight;
     }
-}
 
-void Canvas::setDrawCallback(std::function<void(Canvas*, uint32_t*, int, int)> callback) {
-    drawCallback = callback;
+    // The back buffer holds an older frame; the producer is expected to repaint all of it
+    producerSurface.setTarget(back.pixels, back.width, back.height, back.width);
+    return &producerSurface;
 }
 
-void Canvas::setMouseCallback(std::function<void(int, int, bool)> callback) {
-    mouseCallback = callback;
-}
+void Canvas::publishBackBuffer() {
+    if (!tripleBuffered) return;
 
-void Canvas::setBackgroundColor(uint32_t color) {
-    backgroundColor = color;
+    backIndex = publishedIndex.exchange(backIndex | FRESH_FRAME, std::memory_order_acq_rel) & ~FRESH_FRAME;
 }
 
 void Canvas::setBorderColor(uint32_t color) {
@@ -2,19 +2,60 @@
 #define CANVAS_H
 
 #include "Widget.h"
+#include "CanvasSurface.h"
 #include <functional>
+#include <atomic>
+#include <chrono>
 
 class Canvas : public Widget {
 private:
     uint32_t backgroundColor;
     uint32_t borderColor;
     std::function<void(Canvas*, uint32_t*, int, int)> drawCallback;
+    std::function<void(Canvas*, uint32_t*, int, int, int)> stridedDrawCallback;
     std::function<void(int, int, bool)> mouseCallback;
 
-    uint32_t* canvasBuffer;
+    // Drawing target of the UI thread: the backing buffer, or the window buffer itself
+    // while a direct-rendering callback runs. Backing rows are canvasWidth pixels apart;
+    // the allocation holds backingCapacity pixels so resizes rarely reallocate.
+    CanvasSurface surface;
+    uint32_t* backingBuffer;
+    size_t backingCapacity;
     int canvasWidth;
     int canvasHeight;
     bool mousePressed;
+    bool directRendering;
+
+    // The draw callback waits until setSize has not been called for this long
+    static constexpr int RESIZE_SETTLE_MS = 150;
+    bool resizeSettling;
+    std::chrono::steady_clock::time_point resizeTime;
+
+    // Triple buffering for producer threads: the producer owns backIndex, draw() owns
+    // frontIndex, and the third buffer is exchanged through publishedIndex. Each buffer
+    // carries its own size; setSize only records the new size in requestedSize (width in
+    // the high half) and the producer reallocates its back buffer on the next acquire.
+    struct SwapBuffer {
+        uint32_t* pixels;
+        int width;
+        int height;
+    };
+    static constexpr int FRESH_FRAME = 4;
+    bool tripleBuffered;
+    SwapBuffer swapBuffers[3];
+    int backIndex;
+    int frontIndex;
+    std::atomic<int> publishedIndex;
+    std::atomic<uint64_t> requestedSize;
+    CanvasSurface producerSurface;
+
+    // Region the draw callback still has to regenerate (exclusive right/bottom)
+    bool dirty;
+    int dirtyLeft, dirtyTop, dirtyRight, dirtyBottom;
+
+    void runDrawCallback();
+    void blitContent(const uint32_t* source, int sourceStride, int sourceWidth, int sourceHeight,
+                     uint32_t* buffer, int bufferWidth, int bufferHeight, int contentStartX, int contentStartY);
 
 public:
     Canvas(int x, int y, int width, int height);
@@ -24,25 +65,90 @@ public:
     void handleMouseButton(int mouseX, int mouseY, bool isPressed) override;
     void handleMouseMove(int mouseX, int mouseY) override;
 
-    // Drawing primitives (canvas-relative coordinates)
-    void setPixel(int x, int y, uint32_t color);
-    void drawLine(int x1, int y1, int x2, int y2, uint32_t color);
-    void drawRect(int x, int y, int w, int h, uint32_t color);
-    void fillRect(int x, int y, int w, int h, uint32_t color);
-    void drawCircle(int centerX, int centerY, int radius, uint32_t color);
-    void fillCircle(int centerX, int centerY, int radius, uint32_t color);
-    void clear(uint32_t color);
+    // Resizes the canvas keeping its content anchored top-left. The draw callback runs
+    // once, for the whole canvas, after resizing stops. In triple-buffered mode the producer
+    // picks the new size up on its next acquireBackBuffer().
+    void setSize(int newWidth, int newHeight) override;
+
+    // Drawing primitives (canvas-relative coordinates). They draw on the UI thread's
+    // surface; a producer thread draws through the surface acquireBackBuffer() returns.
+    void setPixel(int x, int y, uint32_t color) { surface.setPixel(x, y, color); }
+    void drawLine(int x1, int y1, int x2, int y2, uint32_t color) { surface.drawLine(x1, y1, x2, y2, color); }
+    void drawRect(int x, int y, int w, int h, uint32_t color) { surface.drawRect(x, y, w, h, color); }
+    void fillRect(int x, int y, int w, int h, uint32_t color) { surface.fillRect(x, y, w, h, color); }
+    void drawCircle(int centerX, int centerY, int radius, uint32_t color) {
+        surface.drawCircle(centerX, centerY, radius, color);
+    }
+    void fillCircle(int centerX, int centerY, int radius, uint32_t color) {
+        surface.fillCircle(centerX, centerY, radius, color);
+    }
+    void clear(uint32_t color) { surface.clear(color); }
 
-    // Callbacks
+    // Anti-aliased shapes, see CanvasSurface
+    void fillPolygonAA(const float* points, int pointCount, uint32_t color) {
+        surface.fillPolygonAA(points, pointCount, color);
+    }
+    void drawPolylineAA(const float* points, int pointCount, float thickness, uint32_t color, bool closed = false) {
+        surface.drawPolylineAA(points, pointCount, thickness, color, closed);
+    }
+    void drawLineAA(float x1, float y1, float x2, float y2, float thickness, uint32_t color) {
+        surface.drawLineAA(x1, y1, x2, y2, thickness, color);
+    }
+    void fillPathAA(const CanvasPath& path, uint32_t color) { surface.fillPathAA(path, color); }
+    void strokePathAA(const CanvasPath& path, float thickness, uint32_t color) {
+        surface.strokePathAA(path, thickness, color);
+    }
+    void fillCircleAA(float centerX, float centerY, float radius, uint32_t color) {
+        surface.fillCircleAA(centerX, centerY, radius, color);
+    }
+    void drawCircleAA(float centerX, float centerY, float radius, float thickness, uint32_t color) {
+        surface.drawCircleAA(centerX, centerY, radius, thickness, color);
+    }
+
+    // The draw callback only runs after the canvas has been invalidated
+    void invalidate();
+    void invalidateRect(int x, int y, int w, int h);
+    bool isDirty() const { return dirty; }
+    void getDirtyRect(int& x, int& y, int& w, int& h) const;
+
+    // Batched primitives, for canvases drawing many shapes per frame
+    void drawLines(const CanvasLine* lines, size_t count) { surface.drawLines(lines, count); }
+    void drawRects(const CanvasRect* rects, size_t count) { surface.drawRects(rects, count); }
+    void fillRects(const CanvasRect* rects, size_t count) { surface.fillRects(rects, count); }
+    void drawCircles(const CanvasCircle* circles, size_t count) { surface.drawCircles(circles, count); }
+    void fillCircles(const CanvasCircle* circles, size_t count) { surface.fillCircles(circles, count); }
+
+    // Callbacks. A draw callback gets the buffer, width and height, with rows width pixels
+    // apart. A strided draw callback also gets the row stride in pixels, which differs from
+    // the width while rendering directly into the window buffer. Setting one clears the other.
     void setDrawCallback(std::function<void(Canvas*, uint32_t*, int, int)> callback);
+    void setStridedDrawCallback(std::function<void(Canvas*, uint32_t*, int, int, int)> callback);
     void setMouseCallback(std::function<void(int, int, bool)> callback);
 
     // Colors
     void setBackgroundColor(uint32_t color);
     void setBorderColor(uint32_t color);
 
-    // Direct buffer access
-    uint32_t* getBuffer() { return canvasBuffer; }
+    // Render a strided draw callback straight into the window buffer instead of the backing
+    // buffer. The callback then runs every frame and must repaint the whole canvas. A plain
+    // draw callback keeps rendering into the backing buffer.
+    void setDirectRendering(bool enabled);
+    bool getDirectRendering() const { return directRendering; }
+
+    // Triple-buffered mode for frames produced on another thread. The producer draws each
+    // frame into the surface acquireBackBuffer() returns, which has its own buffer, clip and
+    // scratch state, then hands it over with publishBackBuffer(). After a resize the surface
+    // comes back at the new size and cleared. draw() only blits the latest published frame
+    // and never runs the draw callback. The mode must only be switched while no producer
+    // is running.
+    void setTripleBuffered(bool enabled);
+    bool isTripleBuffered() const { return tripleBuffered; }
+    CanvasSurface* acquireBackBuffer();
+    void publishBackBuffer();
+
+    // Direct buffer access for the UI thread; rows are getStride() pixels apart
+    uint32_t* getBuffer() { return surface.getBuffer(); }
+    int getStride() const { return surface.getStride(); }
     int getCanvasWidth() const { return canvasWidth; }
     int getCanvasHeight() const { return canvasHeight; }
 };
@@ -0,0 +1,340 @@
+#include "CanvasSurface.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+CanvasSurface::CanvasSurface()
+    : buffer(nullptr),
+      width(0),
+      height(0),
+      stride(0),
+      clipLeft(0),
+      clipTop(0),
+      clipRight(-1),
+      clipBottom(-1),
+      circleSpansRadius(-1) {
+}
+
+void CanvasSurface::setTarget(uint32_t* buffer, int width, int height, int stride) {
+    this->buffer = buffer;
+    this->width = width;
+    this->height = height;
+    this->stride = stride;
+    resetClip();
+}
+
+void CanvasSurface::setClip(int left, int top, int right, int bottom) {
+    clipLeft = std::max(left, 0);
+    clipTop = std::max(top, 0);
+    clipRight = std::min(right, width - 1);
+    clipBottom = std::min(bottom, height - 1);
+}
+
+void CanvasSurface::resetClip() {
+    clipLeft = 0;
+    clipTop = 0;
+    clipRight = width - 1;
+    clipBottom = height - 1;
+}
+
+void CanvasSurface::setPixel(int x, int y, uint32_t color) {
+    if (x >= clipLeft && x <= clipRight && y >= clipTop && y <= clipBottom) {
+        buffer[y * stride + x] = color;
+    }
+}
+
+void CanvasSurface::fillSpan(int y, int x1, int x2, uint32_t color) {
+    if (y < clipTop || y > clipBottom) return;
+    if (x1 < clipLeft) x1 = clipLeft;
+    if (x2 > clipRight) x2 = clipRight;
+    if (x1 > x2) return;
+    std::fill_n(buffer + y * stride + x1, x2 - x1 + 1, color);
+}
+
+void CanvasSurface::fillColumn(int x, int y1, int y2, uint32_t color) {
+    if (x < clipLeft || x > clipRight) return;
+    if (y1 < clipTop) y1 = clipTop;
+    if (y2 > clipBottom) y2 = clipBottom;
+    if (y1 > y2) return;
+    uint32_t* pixel = buffer + y1 * stride + x;
+    for (int y = y1; y <= y2; y++) {
+        *pixel = color;
+        pixel += stride;
+    }
+}
+
+bool CanvasSurface::clipLine(int& x1, int& y1, int& x2, int& y2) const {
+    // Cohen-Sutherland against the clip rectangle
+    const int INSIDE = 0, LEFT = 1, RIGHT = 2, BOTTOM = 4, TOP = 8;
+    const double minX = clipLeft, minY = clipTop;
+    const double maxX = clipRight, maxY = clipBottom;
+
+    auto outCode = [&](double x, double y) {
+        int code = INSIDE;
+        if (x < minX) code |= LEFT;
+        else if (x > maxX) code |= RIGHT;
+        if (y < minY) code |= TOP;
+        else if (y > maxY) code |= BOTTOM;
+        return code;
+    };
+
+    double ax = x1, ay = y1, bx = x2, by = y2;
+    int codeA = outCode(ax, ay);
+    int codeB = outCode(bx, by);
+
+    while (true) {
+        if (!(codeA | codeB)) break;
+        if (codeA & codeB) return false;
+
+        int code = codeA ? codeA : codeB;
+        double x = 0.0, y = 0.0;
+        if (code & TOP) {
+            x = ax + (bx - ax) * (minY - ay) / (by - ay);
+            y = minY;
+        } else if (code & BOTTOM) {
+            x = ax + (bx - ax) * (maxY - ay) / (by - ay);
+            y = maxY;
+        } else if (code & RIGHT) {
+            y = ay + (by - ay) * (maxX - ax) / (bx - ax);
+            x = maxX;
+        } else {
+            y = ay + (by - ay) * (minX - ax) / (bx - ax);
+            x = minX;
+        }
+
+        if (code == codeA) {
+            ax = x;
+            ay = y;
+            codeA = outCode(ax, ay);
+        } else {
+            bx = x;
+            by = y;
+            codeB = outCode(bx, by);
+        }
+    }
+
+    x1 = std::min(std::max((int)std::lround(ax), clipLeft), clipRight);
+    y1 = std::min(std::max((int)std::lround(ay), clipTop), clipBottom);
+    x2 = std::min(std::max((int)std::lround(bx), clipLeft), clipRight);
+    y2 = std::min(std::max((int)std::lround(by), clipTop), clipBottom);
+    return true;
+}
+
+void CanvasSurface::drawLine(int x1, int y1, int x2, int y2, uint32_t color) {
+    if (y1 == y2) {
+        fillSpan(y1, std::min(x1, x2), std::max(x1, x2), color);
+        return;
+    }
+    if (x1 == x2) {
+        fillColumn(x1, std::min(y1, y2), std::max(y1, y2), color);
+        return;
+    }
+
+    // Clip once, then Bresenham's line algorithm without per-pixel bounds checks
+    if (!clipLine(x1, y1, x2, y2)) return;
+
+    int dx = abs(x2 - x1);
+    int dy = abs(y2 - y1);
+    int sx = (x1 < x2) ? 1 : -1;
+    int sy = (y1 < y2) ? stride : -stride;
+    int err = dx - dy;
+    uint32_t* pixel = buffer + y1 * stride + x1;
+    int steps = std::max(dx, dy);
+
+    for (int i = 0; i <= steps; i++) {
+        *pixel = color;
+
+        int e2 = 2 * err;
+        if (e2 > -dy) {
+            err -= dy;
+            pixel += sx;
+        }
+        if (e2 < dx) {
+            err += dx;
+            pixel += sy;
+        }
+    }
+}
+
+void CanvasSurface::drawRect(int x, int y, int w, int h, uint32_t color) {
+    if (w <= 0 || h <= 0) return;
+
+    // Top and bottom edges
+    fillSpan(y, x, x + w - 1, color);
+    fillSpan(y + h - 1, x, x + w - 1, color);
+
+    // Left and right edges
+    fillColumn(x, y + 1, y + h - 2, color);
+    fillColumn(x + w - 1, y + 1, y + h - 2, color);
+}
+
+void CanvasSurface::fillRect(int x, int y, int w, int h, uint32_t color) {
+    int endX = std::min(x + w, clipRight + 1);
+    int endY = std::min(y + h, clipBottom + 1);
+    int startX = std::max(x, clipLeft);
+    int startY = std::max(y, clipTop);
+    if (startX >= endX) return;
+
+    for (int py = startY; py < endY; py++) {
+        std::fill_n(buffer + py * stride + startX, endX - startX, color);
+    }
+}
+
+void CanvasSurface::buildCircleSpans(int radius) {
+    if (radius == circleSpansRadius) return;
+
+    // Midpoint circle algorithm, folded into one half-width per scanline
+    circleSpans.assign(radius + 2, -1);
+    int x = radius;
+    int y = 0;
+    int err = 0;
+
+    while (x >= y) {
+        circleSpans[y] = std::max(circleSpans[y], x);
+        circleSpans[x] = std::max(circleSpans[x], y);
+
+        if (err <= 0) {
+            y += 1;
+            err += 2 * y + 1;
+        }
+        if (err > 0) {
+            x -= 1;
+            err -= 2 * x + 1;
+        }
+    }
+    circleSpansRadius = radius;
+}
+
+void CanvasSurface::drawCircle(int centerX, int centerY, int radius, uint32_t color) {
+    if (radius < 0) return;
+    if (centerX + radius < clipLeft || centerX - radius > clipRight ||
+        centerY + radius < clipTop || centerY - radius > clipBottom) return;
+    buildCircleSpans(radius);
+
+    // Each scanline of the outline is the part of its span not covered by the next row out
+    for (int dy = 0; dy <= radius; dy++) {
+        int outer = circleSpans[dy];
+        int inner = std::min(circleSpans[dy + 1] + 1, outer);
+        fillSpan(centerY + dy, centerX + inner, centerX + outer, color);
+        fillSpan(centerY + dy, centerX - outer, centerX - inner, color);
+        if (dy > 0) {
+            fillSpan(centerY - dy, centerX + inner, centerX + outer, color);
+            fillSpan(centerY - dy, centerX - outer, centerX - inner, color);
+        }
+    }
+}
+
+void CanvasSurface::fillCircle(int centerX, int centerY, int radius, uint32_t color) {
+    if (radius < 0) return;
+    if (centerX + radius < clipLeft || centerX - radius > clipRight ||
+        centerY + radius < clipTop || centerY - radius > clipBottom) return;
+    buildCircleSpans(radius);
+
+    // One horizontal span per scanline
+    int firstRow = std::max(-radius, clipTop - centerY);
+    int lastRow = std::min(radius, clipBottom - centerY);
+    for (int dy = firstRow; dy <= lastRow; dy++) {
+        int halfWidth = circleSpans[dy < 0 ? -dy : dy];
+        fillSpan(centerY + dy, centerX - halfWidth, centerX + halfWidth, color);
+    }
+}
+
+void CanvasSurface::beginPath() {
+    // The rasterizer works on pixel areas; canvas coordinates name pixel centres
+    pathRasterizer.reset(clipLeft, clipTop, clipRight, clipBottom, 0.5f, 0.5f);
+}
+
+void CanvasSurface::endPath(uint32_t color) {
+    pathRasterizer.render(buffer, stride, color);
+}
+
+void CanvasSurface::fillPolygonAA(const float* points, int pointCount, uint32_t color) {
+    if (pointCount < 3) return;
+    beginPath();
+    pathRasterizer.addPolygon(points, pointCount);
+    endPath(color);
+}
+
+void CanvasSurface::drawPolylineAA(const float* points, int pointCount, float thickness, uint32_t color, bool closed) {
+    if (pointCount < 1) return;
+    strokePoints.resize(pointCount);
+    for (int i = 0; i < pointCount; i++) {
+        strokePoints[i] = {points[i * 2], points[i * 2 + 1]};
+    }
+    beginPath();
+    pathRasterizer.addStroke(strokePoints.data(), pointCount, closed, thickness);
+    endPath(color);
+}
+
+void CanvasSurface::drawLineAA(float x1, float y1, float x2, float y2, float thickness, uint32_t color) {
+    float points[4] = {x1, y1, x2, y2};
+    drawPolylineAA(points, 2, thickness, color);
+}
+
+void CanvasSurface::fillPathAA(const CanvasPath& path, uint32_t color) {
+    beginPath();
+    pathRasterizer.addPath(path);
+    endPath(color);
+}
+
+void CanvasSurface::strokePathAA(const CanvasPath& path, float thickness, uint32_t color) {
+    const std::vector<CanvasPath::Point>& points = path.getPoints();
+    const std::vector<int>& ends = path.getContourEnds();
+    const std::vector<bool>& closed = path.getContourClosed();
+    beginPath();
+    int start = 0;
+    for (size_t contour = 0; contour < ends.size(); contour++) {
+        pathRasterizer.addStroke(points.data() + start, ends[contour] - start, closed[contour], thickness);
+        start = ends[contour];
+    }
+    endPath(color);
+}
+
+void CanvasSurface::fillCircleAA(float centerX, float centerY, float radius, uint32_t color) {
+    beginPath();
+    pathRasterizer.addCircle(centerX, centerY, radius);
+    endPath(color);
+}
+
+void CanvasSurface::drawCircleAA(float centerX, float centerY, float radius, float thickness, uint32_t color) {
+    float halfWidth = thickness * 0.5f;
+    beginPath();
+    pathRasterizer.addCircle(centerX, centerY, radius + halfWidth);
+    pathRasterizer.addCircle(centerX, centerY, radius - halfWidth, true);
+    endPath(color);
+}
+
+void CanvasSurface::drawLines(const CanvasLine* lines, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        drawLine(lines[i].x1, lines[i].y1, lines[i].x2, lines[i].y2, lines[i].color);
+    }
+}
+
+void CanvasSurface::drawRects(const CanvasRect* rects, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        drawRect(rects[i].x, rects[i].y, rects[i].w, rects[i].h, rects[i].color);
+    }
+}
+
+void CanvasSurface::fillRects(const CanvasRect* rects, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        fillRect(rects[i].x, rects[i].y, rects[i].w, rects[i].h, rects[i].color);
+    }
+}
+
+void CanvasSurface::drawCircles(const CanvasCircle* circles, size_t count) {
+    // Circles sharing a radius reuse the span table, so sort-by-radius batches are cheapest
+    for (size_t i = 0; i < count; i++) {
+        drawCircle(circles[i].centerX, circles[i].centerY, circles[i].radius, circles[i].color);
+    }
+}
+
+void CanvasSurface::fillCircles(const CanvasCircle* circles, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        fillCircle(circles[i].centerX, circles[i].centerY, circles[i].radius, circles[i].color);
+    }
+}
+
+void CanvasSurface::clear(uint32_t color) {
+    fillRect(clipLeft, clipTop, clipRight - clipLeft + 1, clipBottom - clipTop + 1, color);
+}
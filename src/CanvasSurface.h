@@ -0,0 +1,94 @@
+#ifndef CANVASSURFACE_H
+#define CANVASSURFACE_H
+
+#include "PathRasterizer.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Primitive records for the batched drawing calls
+struct CanvasLine {
+    int x1, y1, x2, y2;
+    uint32_t color;
+};
+
+struct CanvasRect {
+    int x, y, w, h;
+    uint32_t color;
+};
+
+struct CanvasCircle {
+    int centerX, centerY, radius;
+    uint32_t color;
+};
+
+// Pixel buffer plus the clip rectangle and scratch state the drawing primitives need.
+// A surface belongs to one thread at a time; Canvas keeps one for the UI thread and
+// hands another to the producer thread in triple-buffered mode.
+class CanvasSurface {
+private:
+    uint32_t* buffer;
+    int width;
+    int height;
+    int stride;
+
+    // Primitives are clipped to this rectangle (inclusive)
+    int clipLeft, clipTop, clipRight, clipBottom;
+
+    // Half-width of each scanline of the last rasterized circle, indexed by distance from centre
+    std::vector<int> circleSpans;
+    int circleSpansRadius;
+
+    PathRasterizer pathRasterizer;
+    std::vector<CanvasPath::Point> strokePoints;
+
+    void beginPath();
+    void endPath(uint32_t color);
+
+    void fillSpan(int y, int x1, int x2, uint32_t color);
+    void fillColumn(int x, int y1, int y2, uint32_t color);
+    bool clipLine(int& x1, int& y1, int& x2, int& y2) const;
+    void buildCircleSpans(int radius);
+
+public:
+    CanvasSurface();
+
+    // Points the surface at a buffer whose rows are stride pixels apart and resets the clip
+    void setTarget(uint32_t* buffer, int width, int height, int stride);
+    void setClip(int left, int top, int right, int bottom);
+    void resetClip();
+
+    // Drawing primitives (surface-relative coordinates)
+    void setPixel(int x, int y, uint32_t color);
+    void drawLine(int x1, int y1, int x2, int y2, uint32_t color);
+    void drawRect(int x, int y, int w, int h, uint32_t color);
+    void fillRect(int x, int y, int w, int h, uint32_t color);
+    void drawCircle(int centerX, int centerY, int radius, uint32_t color);
+    void fillCircle(int centerX, int centerY, int radius, uint32_t color);
+    void clear(uint32_t color);
+
+    // Anti-aliased shapes. Coordinates are floats on the same grid as the primitives
+    // above, so (x, y) is the centre of pixel (x, y); points are interleaved x, y pairs.
+    void fillPolygonAA(const float* points, int pointCount, uint32_t color);
+    void drawPolylineAA(const float* points, int pointCount, float thickness, uint32_t color, bool closed = false);
+    void drawLineAA(float x1, float y1, float x2, float y2, float thickness, uint32_t color);
+    void fillPathAA(const CanvasPath& path, uint32_t color);
+    void strokePathAA(const CanvasPath& path, float thickness, uint32_t color);
+    void fillCircleAA(float centerX, float centerY, float radius, uint32_t color);
+    void drawCircleAA(float centerX, float centerY, float radius, float thickness, uint32_t color);
+
+    // Batched primitives, for canvases drawing many shapes per frame
+    void drawLines(const CanvasLine* lines, size_t count);
+    void drawRects(const CanvasRect* rects, size_t count);
+    void fillRects(const CanvasRect* rects, size_t count);
+    void drawCircles(const CanvasCircle* circles, size_t count);
+    void fillCircles(const CanvasCircle* circles, size_t count);
+
+    // Direct buffer access; rows are getStride() pixels apart
+    uint32_t* getBuffer() { return buffer; }
+    int getStride() const { return stride; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
+
+#endif
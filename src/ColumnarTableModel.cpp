@@ -0,0 +1,518 @@
+#include "ColumnarTableModel.h"
+#include "DelimitedText.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+static const std::string emptyString;
+
+ColumnarTableModel::ColumnarTableModel(int rows) : rows(std::max(rows, 0)) {
+}
+
+int ColumnarTableModel::addColumn(ColumnType type, const std::string& name) {
+    columns.emplace_back();
+    Column& column = columns.back();
+    column.type = type;
+    column.name = name;
+    resizeColumn(column, rows);
+    notifyStructureChanged();
+    return (int)columns.size() - 1;
+}
+
+void ColumnarTableModel::setRowCount(int newRows) {
+    if (newRows < 0 || newRows == rows) return;
+    for (Column& column : columns) {
+        resizeColumn(column, newRows);
+    }
+    rows = newRows;
+    notifyStructureChanged();
+}
+
+void ColumnarTableModel::resizeColumn(Column& column, int newRows) {
+    switch (column.type) {
+        case ColumnType::INT64: column.ints.resize(newRows, 0); break;
+        case ColumnType::DOUBLE: column.doubles.resize(newRows, 0.0); break;
+        case ColumnType::STRING: column.codes.resize(newRows, 0); break;
+    }
+
+    // Rows past the old end become null
+    int oldRows = (int)std::min<size_t>(column.nullBits.size() * 64, (size_t)rows);
+    column.nullBits.resize((newRows + 63) / 64, 0);
+    for (int row = oldRows; row < newRows; row++) {
+        column.nullBits[row >> 6] |= (uint64_t)1 << (row & 63);
+    }
+}
+
+void ColumnarTableModel::setNullBit(Column& column, int row, bool isNull) {
+    uint64_t mask = (uint64_t)1 << (row & 63);
+    if (isNull) {
+        column.nullBits[row >> 6] |= mask;
+    } else {
+        column.nullBits[row >> 6] &= ~mask;
+    }
+}
+
+uint32_t ColumnarTableModel::internString(Column& column, const std::string& value) {
+    auto it = column.dictionaryIndex.find(value);
+    if (it != column.dictionaryIndex.end()) return it->second;
+
+    uint32_t code = (uint32_t)column.dictionary.size();
+    column.dictionary.push_back(value);
+    column.dictionaryIndex.emplace(value, code);
+    return code;
+}
+
+bool ColumnarTableModel::isValidCell(int row, int col) const {
+    return row >= 0 && row < rows && col >= 0 && col < (int)columns.size();
+}
+
+void ColumnarTableModel::setColumnName(int col, const std::string& name) {
+    if (col < 0 || col >= (int)columns.size()) return;
+    columns[col].name = name;
+    notifyStructureChanged();
+}
+
+std::string ColumnarTableModel::getColumnName(int col) const {
+    if (col < 0 || col >= (int)columns.size()) return "";
+    return columns[col].name;
+}
+
+ColumnType ColumnarTableModel::getColumnType(int col) const {
+    if (col < 0 || col >= (int)columns.size()) return ColumnType::STRING;
+    return columns[col].type;
+}
+
+std::string ColumnarTableModel::formatInt(int64_t value) {
+    char text[24];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    return std::string(text, result.ptr);
+}
+
+std::string ColumnarTableModel::formatDouble(double value) {
+    // Shortest text that reads back as the same double
+    char text[32];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    return std::string(text, result.ptr);
+}
+
+std::string ColumnarTableModel::getCellValue(int row, int col) const {
+    if (!isValidCell(row, col) || isNull(row, col)) return "";
+
+    const Column& column = columns[col];
+    switch (column.type) {
+        case ColumnType::INT64: return formatInt(column.ints[row]);
+        case ColumnType::DOUBLE: return formatDouble(column.doubles[row]);
+        case ColumnType::STRING: return column.dictionary[column.codes[row]];
+    }
+    return "";
+}
+
+void ColumnarTableModel::getCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                      std::vector<std::string>& values) const {
+    // Walk column by column so each typed array is read sequentially
+    values.resize((size_t)rowCount * colCount);
+    for (int c = 0; c < colCount; c++) {
+        for (int r = 0; r < rowCount; r++) {
+            values[(size_t)r * colCount + c] = getCellValue(firstRow + r, firstCol + c);
+        }
+    }
+}
+
+void ColumnarTableModel::appendCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                         char delimiter, std::string& out) const {
+    // Numbers are formatted into a stack buffer and strings appended from the dictionary,
+    // so no string is allocated per cell. Nulls stay empty.
+    char text[32];
+    for (int r = 0; r < rowCount; r++) {
+        int row = firstRow + r;
+        for (int c = 0; c < colCount; c++) {
+            if (c > 0) out += delimiter;
+            int col = firstCol + c;
+            if (!isValidCell(row, col) || isNull(row, col)) continue;
+
+            const Column& column = columns[col];
+            switch (column.type) {
+                case ColumnType::INT64: {
+                    std::to_chars_result result = std::to_chars(text, text + sizeof(text), column.ints[row]);
+                    DelimitedText::appendField(out, text, result.ptr - text, delimiter);
+                    break;
+                }
+                case ColumnType::DOUBLE: {
+                    std::to_chars_result result = std::to_chars(text, text + sizeof(text), column.doubles[row]);
+                    DelimitedText::appendField(out, text, result.ptr - text, delimiter);
+                    break;
+                }
+                case ColumnType::STRING:
+                    DelimitedText::appendField(out, column.dictionary[column.codes[row]], delimiter);
+                    break;
+            }
+        }
+        out += '\n';
+    }
+}
+
+bool ColumnarTableModel::setCellValue(int row, int col, const std::string& value) {
+    if (!isValidCell(row, col)) return false;
+
+    if (value.empty()) {
+        setNull(row, col);
+        return true;
+    }
+
+    Column& column = columns[col];
+    const char* first = value.data();
+    const char* last = value.data() + value.size();
+    switch (column.type) {
+        case ColumnType::INT64: {
+            int64_t parsed = 0;
+            std::from_chars_result result = std::from_chars(first, last, parsed);
+            if (result.ec != std::errc() || result.ptr != last) return false;
+            setInt(row, col, parsed);
+            return true;
+        }
+        case ColumnType::DOUBLE: {
+            double parsed = 0.0;
+            std::from_chars_result result = std::from_chars(first, last, parsed);
+            if (result.ec != std::errc() || result.ptr != last) return false;
+            setDouble(row, col, parsed);
+            return true;
+        }
+        case ColumnType::STRING:
+            setString(row, col, value);
+            return true;
+    }
+    return false;
+}
+
+bool ColumnarTableModel::getIntValue(int row, int col, int64_t& value) const {
+    if (isNull(row, col)) return false;
+    if (columns[col].type == ColumnType::STRING) return TableModel::getIntValue(row, col, value);
+    value = getInt(row, col);
+    return true;
+}
+
+bool ColumnarTableModel::getDoubleValue(int row, int col, double& value) const {
+    if (isNull(row, col)) return false;
+    if (columns[col].type == ColumnType::STRING) return TableModel::getDoubleValue(row, col, value);
+    value = getDouble(row, col);
+    return !std::isnan(value);
+}
+
+bool ColumnarTableModel::isNull(int row, int col) const {
+    if (!isValidCell(row, col)) return true;
+    return (columns[col].nullBits[row >> 6] >> (row & 63)) & 1;
+}
+
+int64_t ColumnarTableModel::getInt(int row, int col) const {
+    if (!isValidCell(row, col)) return 0;
+    const Column& column = columns[col];
+    if (column.type == ColumnType::INT64) return column.ints[row];
+    if (column.type == ColumnType::DOUBLE) return (int64_t)column.doubles[row];
+    return 0;
+}
+
+double ColumnarTableModel::getDouble(int row, int col) const {
+    if (!isValidCell(row, col)) return 0.0;
+    const Column& column = columns[col];
+    if (column.type == ColumnType::DOUBLE) return column.doubles[row];
+    if (column.type == ColumnType::INT64) return (double)column.ints[row];
+    return 0.0;
+}
+
+const std::string& ColumnarTableModel::getString(int row, int col) const {
+    if (!isValidCell(row, col) || columns[col].type != ColumnType::STRING || isNull(row, col)) {
+        return emptyString;
+    }
+    return columns[col].dictionary[columns[col].codes[row]];
+}
+
+uint32_t ColumnarTableModel::getStringCode(int row, int col) const {
+    if (!isValidCell(row, col) || columns[col].type != ColumnType::STRING) return 0;
+    return columns[col].codes[row];
+}
+
+void ColumnarTableModel::setInt(int row, int col, int64_t value) {
+    if (!isValidCell(row, col)) return;
+    Column& column = columns[col];
+    if (column.type == ColumnType::INT64) {
+        column.ints[row] = value;
+    } else if (column.type == ColumnType::DOUBLE) {
+        column.doubles[row] = (double)value;
+    } else {
+        column.codes[row] = internString(column, formatInt(value));
+    }
+    setNullBit(column, row, false);
+    notifyCellsChanged(row, col, row, col);
+}
+
+void ColumnarTableModel::setDouble(int row, int col, double value) {
+    if (!isValidCell(row, col)) return;
+    Column& column = columns[col];
+    if (column.type == ColumnType::DOUBLE) {
+        column.doubles[row] = value;
+    } else if (column.type == ColumnType::INT64) {
+        column.ints[row] = (int64_t)std::llround(value);
+    } else {
+        column.codes[row] = internString(column, formatDouble(value));
+    }
+    setNullBit(column, row, false);
+    notifyCellsChanged(row, col, row, col);
+}
+
+void ColumnarTableModel::setString(int row, int col, const std::string& value) {
+    if (!isValidCell(row, col)) return;
+    Column& column = columns[col];
+    if (column.type != ColumnType::STRING) {
+        setCellValue(row, col, value);
+        return;
+    }
+    column.codes[row] = internString(column, value);
+    setNullBit(column, row, false);
+    notifyCellsChanged(row, col, row, col);
+}
+
+void ColumnarTableModel::setNull(int row, int col) {
+    if (!isValidCell(row, col)) return;
+    setNullBit(columns[col], row, true);
+    notifyCellsChanged(row, col, row, col);
+}
+
+namespace {
+
+const size_t LOAD_CHUNK_BYTES = 1 << 20;
+
+struct ChunkScan {
+    int records = 0;
+    int maxColumns = 0;
+    std::vector<std::string> header;
+    // Per column: saw a non-empty field, and saw one that is not an integer / number
+    std::vector<char> hasValue;
+    std::vector<char> notInt;
+    std::vector<char> notDouble;
+};
+
+struct ChunkLoad {
+    std::vector<std::pair<int, int>> nulls;
+    std::vector<std::vector<std::string>> strings;
+    std::vector<std::unordered_map<std::string, uint32_t>> stringIndex;
+};
+
+bool parsesAsInt(const char* text, size_t length) {
+    int64_t value;
+    std::from_chars_result result = std::from_chars(text, text + length, value);
+    return result.ec == std::errc() && result.ptr == text + length;
+}
+
+bool parsesAsDouble(const char* text, size_t length) {
+    double value;
+    std::from_chars_result result = std::from_chars(text, text + length, value);
+    return result.ec == std::errc() && result.ptr == text + length;
+}
+
+}
+
+bool ColumnarTableModel::loadDelimited(const char* filepath, char delimiter, bool firstRowIsHeader) {
+    MappedFile file;
+    if (!file.open(filepath)) {
+        std::cerr << "Failed to open delimited file: " << filepath << std::endl;
+        return false;
+    }
+    const char* data = (const char*)file.getData();
+    size_t size = file.getSize();
+
+    WorkerPool& pool = WorkerPool::shared();
+    size_t maxChunks = std::max<size_t>(1, size / LOAD_CHUNK_BYTES);
+    int chunkCount = (int)std::min<size_t>(maxChunks, std::max(pool.getThreadCount(), 1) * 4);
+    std::vector<size_t> bounds;
+    DelimitedText::splitRecords(data, size, chunkCount, bounds);
+    chunkCount = (int)bounds.size() - 1;
+
+    // Pass 1: count records and infer column types
+    std::vector<ChunkScan> scans(chunkCount);
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        ChunkScan& scan = scans[chunk];
+        bool inHeader = firstRowIsHeader && chunk == 0;
+        int fieldCount = 0;
+        std::string text;
+        DelimitedText::parse(data + bounds[chunk], data + bounds[chunk + 1], delimiter,
+            [&](int col, const char* field, size_t length, bool escaped) {
+                fieldCount = col + 1;
+                if (inHeader) {
+                    text.clear();
+                    if (escaped) {
+                        DelimitedText::unescape(field, length, text);
+                    } else {
+                        text.assign(field, length);
+                    }
+                    scan.header.push_back(text);
+                    return;
+                }
+                if (length == 0) return;
+                if (col >= (int)scan.hasValue.size()) {
+                    scan.hasValue.resize(col + 1, 0);
+                    scan.notInt.resize(col + 1, 0);
+                    scan.notDouble.resize(col + 1, 0);
+                }
+                scan.hasValue[col] = 1;
+                if (escaped) {
+                    scan.notInt[col] = 1;
+                    scan.notDouble[col] = 1;
+                    return;
+                }
+                if (!scan.notInt[col] && !parsesAsInt(field, length)) {
+                    scan.notInt[col] = 1;
+                }
+                if (scan.notInt[col] && !scan.notDouble[col] && !parsesAsDouble(field, length)) {
+                    scan.notDouble[col] = 1;
+                }
+            },
+            [&]() {
+                if (inHeader) {
+                    inHeader = false;
+                } else {
+                    scan.records++;
+                    scan.maxColumns = std::max(scan.maxColumns, fieldCount);
+                }
+                fieldCount = 0;
+            });
+    });
+
+    std::vector<int> firstRows(chunkCount + 1, 0);
+    int columnCount = 0;
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        int64_t next = (int64_t)firstRows[chunk] + scans[chunk].records;
+        if (next > INT32_MAX) {
+            std::cerr << "Too many records in delimited file: " << filepath << std::endl;
+            return false;
+        }
+        firstRows[chunk + 1] = (int)next;
+        columnCount = std::max({columnCount, scans[chunk].maxColumns, (int)scans[chunk].header.size()});
+    }
+    int totalRows = firstRows[chunkCount];
+
+    std::vector<Column> loaded(columnCount);
+    for (int col = 0; col < columnCount; col++) {
+        bool hasValue = false;
+        bool allInt = true;
+        bool allDouble = true;
+        for (const ChunkScan& scan : scans) {
+            if (col < (int)scan.hasValue.size() && scan.hasValue[col]) {
+                hasValue = true;
+                allInt = allInt && !scan.notInt[col];
+                allDouble = allDouble && !scan.notDouble[col];
+            }
+        }
+        Column& column = loaded[col];
+        column.type = !hasValue ? ColumnType::STRING
+                    : allInt ? ColumnType::INT64
+                    : allDouble ? ColumnType::DOUBLE
+                    : ColumnType::STRING;
+        if (firstRowIsHeader && col < (int)scans[0].header.size()) {
+            column.name = scans[0].header[col];
+        }
+        switch (column.type) {
+            case ColumnType::INT64: column.ints.resize(totalRows); break;
+            case ColumnType::DOUBLE: column.doubles.resize(totalRows); break;
+            case ColumnType::STRING: column.codes.resize(totalRows); break;
+        }
+        column.nullBits.assign(((size_t)totalRows + 63) / 64, 0);
+    }
+
+    // Pass 2: write values at each chunk's row offset. Strings go into chunk-local
+    // dictionaries so no locking is needed; they are merged below.
+    std::vector<ChunkLoad> loads(chunkCount);
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        ChunkLoad& load = loads[chunk];
+        load.strings.resize(columnCount);
+        load.stringIndex.resize(columnCount);
+        bool inHeader = firstRowIsHeader && chunk == 0;
+        int row = firstRows[chunk];
+        int fieldCount = 0;
+        std::string text;
+        DelimitedText::parse(data + bounds[chunk], data + bounds[chunk + 1], delimiter,
+            [&](int col, const char* field, size_t length, bool escaped) {
+                if (inHeader) return;
+                fieldCount = col + 1;
+                if (length == 0) {
+                    load.nulls.emplace_back(row, col);
+                    return;
+                }
+                Column& column = loaded[col];
+                switch (column.type) {
+                    case ColumnType::INT64:
+                        std::from_chars(field, field + length, column.ints[row]);
+                        break;
+                    case ColumnType::DOUBLE:
+                        std::from_chars(field, field + length, column.doubles[row]);
+                        break;
+                    case ColumnType::STRING: {
+                        text.clear();
+                        if (escaped) {
+                            DelimitedText::unescape(field, length, text);
+                        } else {
+                            text.assign(field, length);
+                        }
+                        std::unordered_map<std::string, uint32_t>& index = load.stringIndex[col];
+                        auto found = index.find(text);
+                        if (found == index.end()) {
+                            found = index.emplace(text, (uint32_t)load.strings[col].size()).first;
+                            load.strings[col].push_back(text);
+                        }
+                        column.codes[row] = found->second;
+                        break;
+                    }
+                }
+            },
+            [&]() {
+                if (inHeader) {
+                    inHeader = false;
+                    return;
+                }
+                for (int col = fieldCount; col < columnCount; col++) {
+                    load.nulls.emplace_back(row, col);
+                }
+                row++;
+                fieldCount = 0;
+            });
+        load.stringIndex.clear();
+    });
+
+    // Merge chunk dictionaries in file order, then rewrite codes in parallel
+    std::vector<std::vector<std::vector<uint32_t>>> remaps(chunkCount);
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        remaps[chunk].resize(columnCount);
+        for (int col = 0; col < columnCount; col++) {
+            std::vector<std::string>& strings = loads[chunk].strings[col];
+            if (loaded[col].type != ColumnType::STRING || strings.empty()) continue;
+            remaps[chunk][col].reserve(strings.size());
+            for (std::string& value : strings) {
+                remaps[chunk][col].push_back(internString(loaded[col], value));
+            }
+            std::vector<std::string>().swap(strings);
+        }
+        for (const std::pair<int, int>& cell : loads[chunk].nulls) {
+            setNullBit(loaded[cell.second], cell.first, true);
+        }
+        std::vector<std::pair<int, int>>().swap(loads[chunk].nulls);
+    }
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        for (int col = 0; col < columnCount; col++) {
+            const std::vector<uint32_t>& remap = remaps[chunk][col];
+            if (remap.empty()) continue;
+            std::vector<uint32_t>& codes = loaded[col].codes;
+            for (int row = firstRows[chunk]; row < firstRows[chunk + 1]; row++) {
+                uint32_t code = codes[row];
+                codes[row] = code < remap.size() ? remap[code] : 0;
+            }
+        }
+    });
+
+    columns.swap(loaded);
+    rows = totalRows;
+    notifyStructureChanged();
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef COLUMNARTABLEMODEL_H
+#define COLUMNARTABLEMODEL_H
+
+#include "TableModel.h"
+#include <cstdint>
+#include <unordered_map>
+
+// Table stored column by column in typed arrays: 8 bytes per int64 or double cell, a
+// 4-byte dictionary code per string cell, and one null bit per cell. Text is only
+// produced when a cell is fetched for drawing or editing.
+class ColumnarTableModel : public TableModel {
+private:
+    struct Column {
+        ColumnType type;
+        std::string name;
+        std::vector<int64_t> ints;
+        std::vector<double> doubles;
+        std::vector<uint32_t> codes;
+        std::vector<std::string> dictionary;
+        std::unordered_map<std::string, uint32_t> dictionaryIndex;
+        std::vector<uint64_t> nullBits;
+    };
+
+    std::vector<Column> columns;
+    int rows;
+
+    void resizeColumn(Column& column, int newRows);
+    void setNullBit(Column& column, int row, bool isNull);
+    uint32_t internString(Column& column, const std::string& value);
+    bool isValidCell(int row, int col) const;
+
+public:
+    explicit ColumnarTableModel(int rows = 0);
+
+    // Returns the new column's index; its cells start out null
+    int addColumn(ColumnType type, const std::string& name = "");
+    void setColumnName(int col, const std::string& name);
+    // New rows start out null
+    void setRowCount(int newRows);
+
+    int getRowCount() const override { return rows; }
+    int getColCount() const override { return (int)columns.size(); }
+    ColumnType getColumnType(int col) const override;
+    std::string getColumnName(int col) const override;
+    std::string getCellValue(int row, int col) const override;
+    void getCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                      std::vector<std::string>& values) const override;
+    void appendCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                         char delimiter, std::string& out) const override;
+    // Parses the text for the column's type; empty text stores null, unparsable text is rejected
+    bool setCellValue(int row, int col, const std::string& value) override;
+    bool getIntValue(int row, int col, int64_t& value) const override;
+    bool getDoubleValue(int row, int col, double& value) const override;
+
+    // Typed access without going through text
+    bool isNull(int row, int col) const;
+    int64_t getInt(int row, int col) const;
+    double getDouble(int row, int col) const;
+    const std::string& getString(int row, int col) const;
+    uint32_t getStringCode(int row, int col) const;
+    const std::vector<std::string>& getDictionary(int col) const { return columns[col].dictionary; }
+
+    void setInt(int row, int col, int64_t value);
+    void setDouble(int row, int col, double value);
+    void setString(int row, int col, const std::string& value);
+    void setNull(int row, int col);
+
+    // Replaces the whole table with a CSV/TSV file. The file is mapped, split at record
+    // boundaries and parsed in parallel twice: once to count rows and infer each column's
+    // type (INT64 or DOUBLE when every non-empty field parses, else STRING), once to fill
+    // the typed columns. Empty fields load as null. Listeners see one structure change.
+    bool loadDelimited(const char* filepath, char delimiter = ',', bool firstRowIsHeader = true);
+
+    // Formats a typed value the way getCellValue does
+    static std::string formatInt(int64_t value);
+    static std::string formatDouble(double value);
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "DelimitedText.h"
+#include "WorkerPool.h"
+#include <algorithm>
+
+void DelimitedText::splitRecords(const char* data, size_t size, int chunkCount, std::vector<size_t>& bounds) {
+    chunkCount = std::max(chunkCount, 1);
+    bounds.assign(chunkCount + 1, size);
+    bounds[0] = 0;
+    if (chunkCount == 1) return;
+
+    std::vector<size_t> rawBounds(chunkCount + 1);
+    for (int i = 0; i <= chunkCount; i++) {
+        rawBounds[i] = size * i / chunkCount;
+    }
+
+    // Doubled quotes toggle twice, so the parity of all quotes before a byte says whether
+    // it is inside a quoted field
+    std::vector<size_t> quoteCounts(chunkCount);
+    WorkerPool& pool = WorkerPool::shared();
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        quoteCounts[chunk] = (size_t)std::count(data + rawBounds[chunk], data + rawBounds[chunk + 1], '"');
+    });
+    std::vector<char> startsQuoted(chunkCount, 0);
+    size_t quotes = 0;
+    for (int i = 0; i < chunkCount; i++) {
+        startsQuoted[i] = (char)(quotes & 1);
+        quotes += quoteCounts[i];
+    }
+
+    // Move each split forward to just past the first line break outside quotes
+    pool.parallelFor(chunkCount - 1, [&](int index) {
+        int chunk = index + 1;
+        bool quoted = startsQuoted[chunk] != 0;
+        for (size_t pos = rawBounds[chunk]; pos < size; pos++) {
+            char ch = data[pos];
+            if (ch == '"') {
+                quoted = !quoted;
+            } else if (ch == '\n' && !quoted) {
+                bounds[chunk] = pos + 1;
+                return;
+            }
+        }
+        bounds[chunk] = size;
+    });
+
+    for (int i = 1; i <= chunkCount; i++) {
+        bounds[i] = std::max(bounds[i], bounds[i - 1]);
+    }
+}
+
+void DelimitedText::unescape(const char* text, size_t length, std::string& out) {
+    out.clear();
+    out.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        out.push_back(text[i]);
+        if (text[i] == '"' && i + 1 < length && text[i + 1] == '"') {
+            i++;
+        }
+    }
+}
+
+void DelimitedText::appendField(std::string& out, const std::string& value, char delimiter) {
+    appendField(out, value.data(), value.size(), delimiter);
+}
+
+void DelimitedText::appendField(std::string& out, const char* text, size_t length, char delimiter) {
+    const char* end = text + length;
+    bool needsQuotes = false;
+    for (const char* p = text; p < end; p++) {
+        if (*p == delimiter || *p == '"' || *p == '\r' || *p == '\n') {
+            needsQuotes = true;
+            break;
+        }
+    }
+    if (!needsQuotes) {
+        out.append(text, length);
+        return;
+    }
+
+    out.push_back('"');
+    for (const char* p = text; p < end; p++) {
+        if (*p == '"') {
+            out.push_back('"');
+        }
+        out.push_back(*p);
+    }
+    out.push_back('"');
+}
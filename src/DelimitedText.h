@@ -0,0 +1,122 @@
+#ifndef DELIMITEDTEXT_H
+#define DELIMITEDTEXT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Scanning for CSV/TSV text with RFC 4180 quoting: a field may be wrapped in double
+// quotes, quotes inside it are doubled, and a quoted field may hold delimiters and line
+// breaks. Records end at \n, \r\n or \r; blank lines are skipped.
+class DelimitedText {
+public:
+    // Splits data into at most chunkCount ranges that each start on a record boundary.
+    // Quote parity is counted per chunk in parallel, so a split never lands inside a
+    // quoted field. bounds receives chunkCount + 1 ascending offsets.
+    static void splitRecords(const char* data, size_t size, int chunkCount, std::vector<size_t>& bounds);
+
+    // Calls onField(col, text, length, escaped) for every field and onRecord() after
+    // every record in [begin, end). escaped fields still contain doubled quotes; pass
+    // them through unescape().
+    template <typename FieldFn, typename RecordFn>
+    static void parse(const char* begin, const char* end, char delimiter, FieldFn onField, RecordFn onRecord);
+
+    static void unescape(const char* text, size_t length, std::string& out);
+    // Appends value, quoting it only when it holds the delimiter, a quote or a line break
+    static void appendField(std::string& out, const std::string& value, char delimiter);
+    static void appendField(std::string& out, const char* text, size_t length, char delimiter);
+
+private:
+    static const char* findFieldEnd(const char* p, const char* end, char delimiter);
+};
+
+// Finds the next delimiter or line break eight bytes at a time: XOR with a repeated byte
+// turns matches into zero bytes, and the lowest zero byte of a word is found exactly with
+// the (x - 0x01..) & ~x & 0x80.. test
+inline const char* DelimitedText::findFieldEnd(const char* p, const char* end, char delimiter) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t delimiters = ones * (uint8_t)delimiter;
+    const uint64_t newlines = ones * (uint8_t)'\n';
+    const uint64_t returns = ones * (uint8_t)'\r';
+    while (end - p >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        uint64_t a = word ^ delimiters;
+        uint64_t b = word ^ newlines;
+        uint64_t c = word ^ returns;
+        uint64_t hits = (((a - ones) & ~a) | ((b - ones) & ~b) | ((c - ones) & ~c)) & highs;
+        if (hits) {
+            return p + (__builtin_ctzll(hits) >> 3);
+        }
+        p += 8;
+    }
+#endif
+    while (p < end && *p != delimiter && *p != '\n' && *p != '\r') {
+        p++;
+    }
+    return p;
+}
+
+template <typename FieldFn, typename RecordFn>
+void DelimitedText::parse(const char* begin, const char* end, char delimiter, FieldFn onField, RecordFn onRecord) {
+    const char* p = begin;
+    while (p < end) {
+        // Skip blank lines between records
+        if (*p == '\n' || *p == '\r') {
+            p++;
+            continue;
+        }
+
+        int col = 0;
+        while (true) {
+            if (p < end && *p == '"') {
+                const char* text = ++p;
+                bool escaped = false;
+                while (true) {
+                    const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+                    if (!quote) {
+                        p = end;
+                        break;
+                    }
+                    if (quote + 1 < end && quote[1] == '"') {
+                        escaped = true;
+                        p = quote + 2;
+                        continue;
+                    }
+                    p = quote;
+                    break;
+                }
+                onField(col, text, (size_t)(p - text), escaped);
+                if (p < end) {
+                    p++;
+                }
+                // Anything between the closing quote and the next delimiter is dropped
+                p = findFieldEnd(p, end, delimiter);
+            } else {
+                const char* text = p;
+                p = findFieldEnd(p, end, delimiter);
+                onField(col, text, (size_t)(p - text), false);
+            }
+
+            if (p < end && *p == delimiter) {
+                p++;
+                col++;
+                continue;
+            }
+            break;
+        }
+
+        if (p < end && *p == '\r') {
+            p++;
+        }
+        if (p < end && *p == '\n') {
+            p++;
+        }
+        onRecord();
+    }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include "FenwickTree.h"
+
+FenwickTree::FenwickTree() : highBit(0) {
+}
+
+void FenwickTree::assign(int count, int value) {
+    values.assign(count > 0 ? count : 0, value);
+    build();
+}
+
+void FenwickTree::assign(const std::vector<int>& newValues) {
+    values = newValues;
+    build();
+}
+
+void FenwickTree::resize(int count, int value) {
+    values.resize(count > 0 ? count : 0, value);
+    build();
+}
+
+void FenwickTree::build() {
+    // Linear build: each node pushes its sum up to its parent once
+    int count = (int)values.size();
+    tree.assign(count + 1, 0);
+    for (int i = 1; i <= count; i++) {
+        tree[i] += values[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= count) {
+            tree[parent] += tree[i];
+        }
+    }
+
+    highBit = 1;
+    while (highBit * 2 <= count) {
+        highBit *= 2;
+    }
+}
+
+void FenwickTree::set(int index, int value) {
+    if (index < 0 || index >= (int)values.size()) return;
+
+    int64_t delta = (int64_t)value - values[index];
+    values[index] = value;
+    for (int i = index + 1; i < (int)tree.size(); i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+int64_t FenwickTree::prefixSum(int index) const {
+    if (index > (int)values.size()) index = (int)values.size();
+
+    int64_t sum = 0;
+    for (int i = index; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+int FenwickTree::findIndex(int64_t offset) const {
+    int count = (int)values.size();
+    if (count == 0 || offset < 0) return 0;
+
+    // Descend from the highest power of two to the last entry whose end is <= offset
+    int position = 0;
+    for (int step = highBit; step > 0; step >>= 1) {
+        int next = position + step;
+        if (next <= count && tree[next] <= offset) {
+            position = next;
+            offset -= tree[next];
+        }
+    }
+    return position < count ? position : count - 1;
+}
@@ -0,0 +1,37 @@
+#ifndef FENWICKTREE_H
+#define FENWICKTREE_H
+
+#include <cstdint>
+#include <vector>
+
+// Prefix sums over a list of sizes (row heights, column widths) with O(log n) updates,
+// offset-of-index and index-at-offset queries. Sizes must be positive.
+class FenwickTree {
+private:
+    std::vector<int64_t> tree;
+    std::vector<int> values;
+    int highBit;
+
+    void build();
+
+public:
+    FenwickTree();
+
+    // Replaces every entry; O(n)
+    void assign(int count, int value);
+    void assign(const std::vector<int>& newValues);
+    // Keeps existing entries and fills new ones with value; O(n)
+    void resize(int count, int value);
+
+    void set(int index, int value);
+    int get(int index) const { return values[index]; }
+    int size() const { return (int)values.size(); }
+
+    // Sum of entries before index, i.e. the offset where entry index starts
+    int64_t prefixSum(int index) const;
+    int64_t total() const { return prefixSum((int)values.size()); }
+    // Entry covering offset, clamped to [0, size() - 1]; 0 when empty
+    int findIndex(int64_t offset) const;
+};
+
+#endif
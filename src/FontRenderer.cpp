@@ -1,4 +1,5 @@
 #include "FontRenderer.h"
+#include "PixelBlend.h"
 #include <algorithm>
 
 FontRenderer::FontRenderer() : library(nullptr), face(nullptr), fontSize(12) {
@@ -27,11 +28,26 @@ bool FontRenderer::loadFont(const char* fontPath, int size) {
 
 void FontRenderer::drawText(uint32_t* buffer, int bufferWidth, int bufferHeight,
                            const std::string& text, int x, int y, uint32_t color) {
+    drawTextClipped(buffer, bufferWidth, bufferHeight, text, x, y, color, 0, 0, bufferWidth, bufferHeight);
+}
+
+void FontRenderer::drawTextClipped(uint32_t* buffer, int bufferWidth, int bufferHeight,
+                                   const std::string& text, int x, int y, uint32_t color,
+                                   int clipLeft, int clipTop, int clipRight, int clipBottom) {
     if (!face) {
         return;
     }
 
+    clipLeft = std::max(clipLeft, 0);
+    clipTop = std::max(clipTop, 0);
+    clipRight = std::min(clipRight, bufferWidth);
+    clipBottom = std::min(clipBottom, bufferHeight);
+    if (clipLeft >= clipRight || clipTop >= clipBottom) {
+        return;
+    }
+
     int cursorX = x;
+    uint32_t opaqueColor = color | 0xFF000000;
 
     for (char c : text) {
         if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
@@ -49,26 +65,13 @@ void FontRenderer::drawText(uint32_t* buffer, int bufferWidth, int bufferHeight,
                 int px = bitmapX + col;
                 int py = bitmapY + row;
 
-                if (px >= 0 && px < bufferWidth && py >= 0 && py < bufferHeight) {
+                if (px >= clipLeft && px < clipRight && py >= clipTop && py < clipBottom) {
                     unsigned char alpha = bitmap.buffer[row * bitmap.width + col];
 
-                    if (alpha > 0) {
-                        uint32_t existingColor = buffer[py * bufferWidth + px];
-
-                        int r = (color & 0xFF0000) >> 16;
-                        int g = (color & 0x00FF00) >> 8;
-                        int b = (color & 0x0000FF);
-
-                        int bgR = (existingColor & 0xFF0000) >> 16;
-                        int bgG = (existingColor & 0x00FF00) >> 8;
-                        int bgB = (existingColor & 0x0000FF);
-
-                        float a = alpha / 255.0f;
-                        int finalR = (int)(r * a + bgR * (1 - a));
-                        int finalG = (int)(g * a + bgG * (1 - a));
-                        int finalB = (int)(b * a + bgB * (1 - a));
-
-                        buffer[py * bufferWidth + px] = 0xFF000000 | (finalR << 16) | (finalG << 8) | finalB;
+                    if (alpha == 255) {
+                        buffer[py * bufferWidth + px] = opaqueColor;
+                    } else if (alpha > 0) {
+                        buffer[py * bufferWidth + px] = blendCoverage(color, alpha, buffer[py * bufferWidth + px]);
                     }
                 }
             }
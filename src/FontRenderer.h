@@ -19,6 +19,10 @@ public:
     bool loadFont(const char* fontPath, int size);
     void drawText(uint32_t* buffer, int bufferWidth, int bufferHeight,
                   const std::string& text, int x, int y, uint32_t color);
+    // Like drawText but only touches pixels inside [clipLeft, clipRight) x [clipTop, clipBottom)
+    void drawTextClipped(uint32_t* buffer, int bufferWidth, int bufferHeight,
+                         const std::string& text, int x, int y, uint32_t color,
+                         int clipLeft, int clipTop, int clipRight, int clipBottom);
     int getTextWidth(const std::string& text);
     int getTextHeight();
 };
@@ -0,0 +1,788 @@
+#include "FormulaEngine.h"
+#include "ColumnarTableModel.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Levels smaller than this are evaluated on the calling thread
+const size_t PARALLEL_FORMULAS = 256;
+const int FORMULA_CHUNK = 128;
+
+enum Function { SUM, AVERAGE, MIN, MAX, COUNT, ABS, SQRT, ROUND, IF };
+
+struct FunctionInfo {
+    const char* name;
+    int minArgs;
+    int maxArgs;
+};
+
+// Indexed by Function; everything up to COUNT aggregates its arguments and ranges
+const FunctionInfo functionTable[] = {
+    {"SUM", 1, 255}, {"AVERAGE", 1, 255}, {"MIN", 1, 255}, {"MAX", 1, 255}, {"COUNT", 1, 255},
+    {"ABS", 1, 1}, {"SQRT", 1, 1}, {"ROUND", 1, 2}, {"IF", 2, 3}
+};
+
+bool isLetter(char ch) {
+    return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z');
+}
+
+bool isDigit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+}
+
+// Recursive descent from the lowest precedence down: comparison, + -, * /, unary, ^
+class FormulaEngine::Parser {
+private:
+    const std::string& text;
+    size_t pos;
+    Formula& formula;
+
+    void skipSpaces() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+            pos++;
+        }
+    }
+
+    bool match(char ch) {
+        skipSpaces();
+        if (pos < text.size() && text[pos] == ch) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void emit(OpCode code, int arg = 0, int argCount = 0, double number = 0.0) {
+        Op op;
+        op.code = code;
+        op.arg = arg;
+        op.argCount = argCount;
+        op.number = number;
+        formula.code.push_back(op);
+    }
+
+    bool parseComparison() {
+        if (!parseAdditive()) return false;
+        while (true) {
+            skipSpaces();
+            OpCode code;
+            if (text.compare(pos, 2, "<>") == 0) {
+                code = OpCode::NOT_EQUAL;
+                pos += 2;
+            } else if (text.compare(pos, 2, "<=") == 0) {
+                code = OpCode::LESS_EQUAL;
+                pos += 2;
+            } else if (text.compare(pos, 2, ">=") == 0) {
+                code = OpCode::GREATER_EQUAL;
+                pos += 2;
+            } else if (match('<')) {
+                code = OpCode::LESS;
+            } else if (match('>')) {
+                code = OpCode::GREATER;
+            } else if (match('=')) {
+                code = OpCode::EQUAL;
+            } else {
+                return true;
+            }
+            if (!parseAdditive()) return false;
+            emit(code);
+        }
+    }
+
+    bool parseAdditive() {
+        if (!parseTerm()) return false;
+        while (true) {
+            OpCode code;
+            if (match('+')) {
+                code = OpCode::ADD;
+            } else if (match('-')) {
+                code = OpCode::SUBTRACT;
+            } else {
+                return true;
+            }
+            if (!parseTerm()) return false;
+            emit(code);
+        }
+    }
+
+    bool parseTerm() {
+        if (!parseUnary()) return false;
+        while (true) {
+            OpCode code;
+            if (match('*')) {
+                code = OpCode::MULTIPLY;
+            } else if (match('/')) {
+                code = OpCode::DIVIDE;
+            } else {
+                return true;
+            }
+            if (!parseUnary()) return false;
+            emit(code);
+        }
+    }
+
+    bool parseUnary() {
+        if (match('-')) {
+            if (!parseUnary()) return false;
+            emit(OpCode::NEGATE);
+            return true;
+        }
+        if (match('+')) {
+            return parseUnary();
+        }
+        if (!parsePrimary(false)) return false;
+        if (match('^')) {
+            if (!parseUnary()) return false;
+            emit(OpCode::POWER);
+        }
+        return true;
+    }
+
+    // Reads an A1 reference with optional $ markers; columns are limited to three letters
+    bool parseCell(int& row, int& col) {
+        skipSpaces();
+        if (pos < text.size() && text[pos] == '$') pos++;
+        size_t start = pos;
+        int64_t column = 0;
+        while (pos < text.size() && isLetter(text[pos])) {
+            column = column * 26 + ((text[pos] & ~0x20) - 'A' + 1);
+            pos++;
+        }
+        if (pos == start || pos - start > 3) return false;
+        if (pos < text.size() && text[pos] == '$') pos++;
+        start = pos;
+        int64_t number = 0;
+        while (pos < text.size() && isDigit(text[pos]) && pos - start < 10) {
+            number = number * 10 + (text[pos] - '0');
+            pos++;
+        }
+        if (pos == start || number < 1 || number > std::numeric_limits<int>::max()) return false;
+        row = (int)(number - 1);
+        col = (int)(column - 1);
+        return true;
+    }
+
+    bool parseReference(bool allowRange) {
+        int firstRow, firstCol;
+        if (!parseCell(firstRow, firstCol)) return false;
+        int lastRow = firstRow;
+        int lastCol = firstCol;
+        bool isRange = allowRange && match(':');
+        if (isRange && !parseCell(lastRow, lastCol)) return false;
+
+        Reference reference;
+        reference.firstRow = std::min(firstRow, lastRow);
+        reference.lastRow = std::max(firstRow, lastRow);
+        reference.firstCol = std::min(firstCol, lastCol);
+        reference.lastCol = std::max(firstCol, lastCol);
+        formula.references.push_back(reference);
+        emit(isRange ? OpCode::RANGE : OpCode::CELL, (int)formula.references.size() - 1);
+        return true;
+    }
+
+    bool parsePrimary(bool allowRange) {
+        skipSpaces();
+        if (pos >= text.size()) return false;
+        char ch = text[pos];
+
+        if (isDigit(ch) || ch == '.') {
+            double number;
+            std::from_chars_result result = std::from_chars(text.data() + pos, text.data() + text.size(), number);
+            if (result.ec != std::errc()) return false;
+            pos = result.ptr - text.data();
+            emit(OpCode::NUMBER, 0, 0, number);
+            return true;
+        }
+
+        if (match('(')) {
+            return parseComparison() && match(')');
+        }
+
+        if (ch == '$') {
+            return parseReference(allowRange);
+        }
+        if (!isLetter(ch)) return false;
+
+        // A name directly followed by '(' is a function; anything else is a reference
+        size_t start = pos;
+        std::string name;
+        while (pos < text.size() && isLetter(text[pos])) {
+            name += (char)(text[pos] & ~0x20);
+            pos++;
+        }
+        if (!match('(')) {
+            pos = start;
+            return parseReference(allowRange);
+        }
+
+        int function = -1;
+        for (int i = 0; i < (int)(sizeof(functionTable) / sizeof(functionTable[0])); i++) {
+            if (name == functionTable[i].name) {
+                function = i;
+                break;
+            }
+        }
+        if (function < 0) return false;
+
+        int argCount = 0;
+        if (!match(')')) {
+            do {
+                if (!parseArgument()) return false;
+                argCount++;
+            } while (match(','));
+            if (!match(')')) return false;
+        }
+        if (argCount < functionTable[function].minArgs || argCount > functionTable[function].maxArgs) {
+            return false;
+        }
+        emit(OpCode::CALL, function, argCount);
+        return true;
+    }
+
+    // A range on its own, or any expression
+    bool parseArgument() {
+        size_t start = pos;
+        size_t codeSize = formula.code.size();
+        size_t referenceCount = formula.references.size();
+        if (parsePrimary(true) && formula.code.back().code == OpCode::RANGE) {
+            skipSpaces();
+            if (pos < text.size() && (text[pos] == ',' || text[pos] == ')')) return true;
+        }
+        pos = start;
+        formula.code.resize(codeSize);
+        formula.references.resize(referenceCount);
+        return parseComparison();
+    }
+
+public:
+    Parser(const std::string& text, Formula& formula) : text(text), pos(1), formula(formula) {
+    }
+
+    bool parse() {
+        if (!parseComparison()) return false;
+        skipSpaces();
+        return pos == text.size();
+    }
+};
+
+FormulaEngine::FormulaEngine(TableModel* model)
+    : model(model), cellReferenceCount(0), writingResults(false) {
+}
+
+const char* FormulaEngine::getErrorText(Error error) {
+    switch (error) {
+        case Error::NONE: return "";
+        case Error::SYNTAX: return "#ERROR!";
+        case Error::VALUE: return "#VALUE!";
+        case Error::DIV0: return "#DIV/0!";
+        case Error::REF: return "#REF!";
+        case Error::NUM: return "#NUM!";
+        case Error::CYCLE: return "#CYCLE!";
+    }
+    return "";
+}
+
+bool FormulaEngine::setFormula(int row, int col, const std::string& text) {
+    if (row < 0 || col < 0 || row >= model->getRowCount() || col >= model->getColCount()) return false;
+
+    int id;
+    auto found = formulaAt.find(cellKey(row, col));
+    if (found != formulaAt.end()) {
+        id = found->second;
+        removeDependencies(id);
+    } else {
+        if (!freeFormulas.empty()) {
+            id = freeFormulas.back();
+            freeFormulas.pop_back();
+        } else {
+            id = (int)formulas.size();
+            formulas.emplace_back();
+            dirtySlots.push_back(-1);
+        }
+        formulaAt[cellKey(row, col)] = id;
+        if (col >= (int)columnFormulaCounts.size()) {
+            columnFormulaCounts.resize(col + 1, 0);
+        }
+        columnFormulaCounts[col]++;
+    }
+
+    Formula& formula = formulas[id];
+    formula = Formula();
+    formula.row = row;
+    formula.col = col;
+    formula.text = text;
+    bool parsed = isFormula(text) && Parser(text, formula).parse();
+    if (!parsed) {
+        formula.code.clear();
+        formula.references.clear();
+    }
+    addDependencies(id);
+
+    std::vector<int> seeds(1, id);
+    recalculate(seeds);
+    return parsed;
+}
+
+void FormulaEngine::removeFormula(int row, int col) {
+    auto found = formulaAt.find(cellKey(row, col));
+    if (found == formulaAt.end()) return;
+
+    int id = found->second;
+    removeDependencies(id);
+    formulaAt.erase(found);
+    columnFormulaCounts[col]--;
+    formulas[id] = Formula();
+    freeFormulas.push_back(id);
+}
+
+bool FormulaEngine::hasFormula(int row, int col) const {
+    if (col < 0 || col >= (int)columnFormulaCounts.size() || columnFormulaCounts[col] == 0) return false;
+    return formulaAt.count(cellKey(row, col)) > 0;
+}
+
+std::string FormulaEngine::getFormula(int row, int col) const {
+    auto found = formulaAt.find(cellKey(row, col));
+    return found != formulaAt.end() ? formulas[found->second].text : std::string();
+}
+
+void FormulaEngine::clear() {
+    formulas.clear();
+    freeFormulas.clear();
+    dirtySlots.clear();
+    formulaAt.clear();
+    columnFormulaCounts.clear();
+    cellDependents.clear();
+    rangeDependents.clear();
+    cellReferenceCount = 0;
+}
+
+void FormulaEngine::addDependencies(int id) {
+    for (const Reference& ref : formulas[id].references) {
+        if (ref.firstRow == ref.lastRow && ref.firstCol == ref.lastCol) {
+            cellDependents[cellKey(ref.firstRow, ref.firstCol)].push_back(id);
+            cellReferenceCount++;
+            continue;
+        }
+        if (ref.lastCol >= (int)rangeDependents.size()) {
+            rangeDependents.resize(ref.lastCol + 1);
+        }
+        for (int col = ref.firstCol; col <= ref.lastCol; col++) {
+            rangeDependents[col].push_back({ref.firstRow, ref.lastRow, id});
+        }
+    }
+}
+
+void FormulaEngine::removeDependencies(int id) {
+    for (const Reference& ref : formulas[id].references) {
+        if (ref.firstRow == ref.lastRow && ref.firstCol == ref.lastCol) {
+            auto found = cellDependents.find(cellKey(ref.firstRow, ref.firstCol));
+            if (found == cellDependents.end()) continue;
+            std::vector<int>& dependents = found->second;
+            auto entry = std::find(dependents.begin(), dependents.end(), id);
+            if (entry != dependents.end()) {
+                dependents.erase(entry);
+                cellReferenceCount--;
+            }
+            if (dependents.empty()) {
+                cellDependents.erase(found);
+            }
+            continue;
+        }
+        for (int col = ref.firstCol; col <= ref.lastCol; col++) {
+            std::vector<RangeDependent>& dependents = rangeDependents[col];
+            auto entry = std::find_if(dependents.begin(), dependents.end(), [&](const RangeDependent& dependent) {
+                return dependent.formula == id && dependent.firstRow == ref.firstRow && dependent.lastRow == ref.lastRow;
+            });
+            if (entry != dependents.end()) {
+                dependents.erase(entry);
+            }
+        }
+    }
+}
+
+// Appends every formula reading a cell of the block, once per matching reference
+void FormulaEngine::collectDependents(int firstRow, int firstCol, int lastRow, int lastCol, std::vector<int>& out) const {
+    int64_t area = (int64_t)(lastRow - firstRow + 1) * (lastCol - firstCol + 1);
+    if (area <= (int64_t)cellReferenceCount) {
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                auto found = cellDependents.find(cellKey(row, col));
+                if (found != cellDependents.end()) {
+                    out.insert(out.end(), found->second.begin(), found->second.end());
+                }
+            }
+        }
+    } else {
+        for (const auto& entry : cellDependents) {
+            int row = (int)(entry.first >> 32);
+            int col = (int)(uint32_t)entry.first;
+            if (row >= firstRow && row <= lastRow && col >= firstCol && col <= lastCol) {
+                out.insert(out.end(), entry.second.begin(), entry.second.end());
+            }
+        }
+    }
+
+    int endCol = std::min(lastCol, (int)rangeDependents.size() - 1);
+    for (int col = firstCol; col <= endCol; col++) {
+        for (const RangeDependent& dependent : rangeDependents[col]) {
+            if (dependent.firstRow <= lastRow && dependent.lastRow >= firstRow) {
+                out.push_back(dependent.formula);
+            }
+        }
+    }
+}
+
+// Returns false for cells an aggregate should skip: empty, or text when skipText is set
+bool FormulaEngine::readCell(int row, int col, Value& value, bool skipText) const {
+    value = Value();
+    if (row >= model->getRowCount() || col >= model->getColCount()) {
+        value.error = Error::REF;
+        return true;
+    }
+    if (col < (int)columnFormulaCounts.size() && columnFormulaCounts[col] > 0) {
+        auto found = formulaAt.find(cellKey(row, col));
+        if (found != formulaAt.end()) {
+            value = formulas[found->second].result;
+            return true;
+        }
+    }
+    if (model->getDoubleValue(row, col, value.number)) return true;
+
+    // Empty cells count as 0 in arithmetic; text cannot be used there
+    value.number = 0.0;
+    if (skipText) return false;
+    if (!model->getCellValue(row, col).empty()) {
+        value.error = Error::VALUE;
+    }
+    return true;
+}
+
+FormulaEngine::Value FormulaEngine::evaluateFunction(const Formula& formula, int function, const Value* args, int argCount) const {
+    Value result;
+    if (function <= COUNT) {
+        double sum = 0.0;
+        double minimum = std::numeric_limits<double>::infinity();
+        double maximum = -std::numeric_limits<double>::infinity();
+        int64_t count = 0;
+        auto add = [&](double number) {
+            sum += number;
+            minimum = std::min(minimum, number);
+            maximum = std::max(maximum, number);
+            count++;
+        };
+
+        for (int i = 0; i < argCount; i++) {
+            const Value& arg = args[i];
+            if (arg.error != Error::NONE) return arg;
+            if (arg.range < 0) {
+                add(arg.number);
+                continue;
+            }
+            // Ranges reaching past the model only cover the cells that exist
+            const Reference& ref = formula.references[arg.range];
+            int lastRow = std::min(ref.lastRow, model->getRowCount() - 1);
+            int lastCol = std::min(ref.lastCol, model->getColCount() - 1);
+            for (int col = ref.firstCol; col <= lastCol; col++) {
+                for (int row = ref.firstRow; row <= lastRow; row++) {
+                    Value cell;
+                    if (!readCell(row, col, cell, true)) continue;
+                    if (cell.error != Error::NONE) return cell;
+                    add(cell.number);
+                }
+            }
+        }
+
+        switch (function) {
+            case SUM: result.number = sum; break;
+            case AVERAGE:
+                if (count == 0) {
+                    result.error = Error::DIV0;
+                } else {
+                    result.number = sum / count;
+                }
+                break;
+            case MIN: result.number = count > 0 ? minimum : 0.0; break;
+            case MAX: result.number = count > 0 ? maximum : 0.0; break;
+            default: result.number = (double)count; break;
+        }
+        return result;
+    }
+
+    for (int i = 0; i < argCount; i++) {
+        if (args[i].range >= 0) {
+            result.error = Error::VALUE;
+            return result;
+        }
+    }
+
+    // IF passes the unchosen branch's errors over
+    if (function == IF) {
+        if (args[0].error != Error::NONE) return args[0];
+        if (args[0].number != 0.0) return args[1];
+        return argCount > 2 ? args[2] : result;
+    }
+
+    for (int i = 0; i < argCount; i++) {
+        if (args[i].error != Error::NONE) return args[i];
+    }
+    double number = args[0].number;
+    switch (function) {
+        case ABS: result.number = std::fabs(number); break;
+        case SQRT:
+            if (number < 0.0) {
+                result.error = Error::NUM;
+            } else {
+                result.number = std::sqrt(number);
+            }
+            break;
+        case ROUND: {
+            double scale = std::pow(10.0, argCount > 1 ? std::trunc(args[1].number) : 0.0);
+            result.number = std::round(number * scale) / scale;
+            break;
+        }
+    }
+    return result;
+}
+
+FormulaEngine::Value FormulaEngine::evaluate(const Formula& formula) const {
+    Value result;
+    if (formula.code.empty()) {
+        result.error = Error::SYNTAX;
+        return result;
+    }
+
+    std::vector<Value> stack;
+    stack.reserve(16);
+    for (const Op& op : formula.code) {
+        switch (op.code) {
+            case OpCode::NUMBER:
+                stack.emplace_back();
+                stack.back().number = op.number;
+                break;
+            case OpCode::CELL: {
+                const Reference& ref = formula.references[op.arg];
+                Value value;
+                readCell(ref.firstRow, ref.firstCol, value, false);
+                stack.push_back(value);
+                break;
+            }
+            case OpCode::RANGE:
+                stack.emplace_back();
+                stack.back().range = op.arg;
+                break;
+            case OpCode::NEGATE: {
+                Value& value = stack.back();
+                if (value.range >= 0) {
+                    value = Value();
+                    value.error = Error::VALUE;
+                }
+                value.number = -value.number;
+                break;
+            }
+            case OpCode::CALL: {
+                size_t base = stack.size() - op.argCount;
+                Value value = evaluateFunction(formula, op.arg, stack.data() + base, op.argCount);
+                stack.resize(base);
+                stack.push_back(value);
+                break;
+            }
+            default: {
+                Value right = stack.back();
+                stack.pop_back();
+                Value left = stack.back();
+                Value& value = stack.back();
+                value = Value();
+                if (left.error != Error::NONE || right.error != Error::NONE) {
+                    value.error = left.error != Error::NONE ? left.error : right.error;
+                    break;
+                }
+                if (left.range >= 0 || right.range >= 0) {
+                    value.error = Error::VALUE;
+                    break;
+                }
+                double a = left.number;
+                double b = right.number;
+                switch (op.code) {
+                    case OpCode::ADD: value.number = a + b; break;
+                    case OpCode::SUBTRACT: value.number = a - b; break;
+                    case OpCode::MULTIPLY: value.number = a * b; break;
+                    case OpCode::DIVIDE:
+                        if (b == 0.0) {
+                            value.error = Error::DIV0;
+                        } else {
+                            value.number = a / b;
+                        }
+                        break;
+                    case OpCode::POWER: value.number = std::pow(a, b); break;
+                    case OpCode::EQUAL: value.number = a == b; break;
+                    case OpCode::NOT_EQUAL: value.number = a != b; break;
+                    case OpCode::LESS: value.number = a < b; break;
+                    case OpCode::LESS_EQUAL: value.number = a <= b; break;
+                    case OpCode::GREATER: value.number = a > b; break;
+                    case OpCode::GREATER_EQUAL: value.number = a >= b; break;
+                    default: break;
+                }
+                break;
+            }
+        }
+    }
+
+    result = stack.back();
+    if (result.range >= 0) {
+        result = Value();
+        result.error = Error::VALUE;
+    } else if (result.error == Error::NONE && !std::isfinite(result.number)) {
+        result.number = 0.0;
+        result.error = Error::NUM;
+    }
+    return result;
+}
+
+void FormulaEngine::recalculate(std::vector<int>& seeds) {
+    // Gather everything downstream of the seeds. dirtySlots maps a formula to its place in
+    // order, and edges[i] lists the dirty formulas that read order[i]'s cell.
+    std::vector<int> order;
+    std::vector<std::vector<int>> edges;
+    std::vector<int> dependents;
+    for (int id : seeds) {
+        if (dirtySlots[id] < 0) {
+            dirtySlots[id] = (int)order.size();
+            order.push_back(id);
+        }
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        const Formula& formula = formulas[order[i]];
+        dependents.clear();
+        collectDependents(formula.row, formula.col, formula.row, formula.col, dependents);
+        std::vector<int> targets;
+        targets.reserve(dependents.size());
+        for (int id : dependents) {
+            if (dirtySlots[id] < 0) {
+                dirtySlots[id] = (int)order.size();
+                order.push_back(id);
+            }
+            targets.push_back(dirtySlots[id]);
+        }
+        edges.push_back(std::move(targets));
+    }
+
+    std::vector<int> pending(order.size(), 0);
+    for (const std::vector<int>& targets : edges) {
+        for (int target : targets) {
+            pending[target]++;
+        }
+    }
+
+    // Kahn's algorithm one level at a time; a level's formulas only read earlier levels
+    WorkerPool& pool = WorkerPool::shared();
+    std::vector<int> sorted;
+    std::vector<int> level;
+    std::vector<int> nextLevel;
+    sorted.reserve(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        if (pending[i] == 0) {
+            level.push_back((int)i);
+        }
+    }
+    while (!level.empty()) {
+        if (level.size() >= PARALLEL_FORMULAS && pool.getThreadCount() > 1) {
+            int chunkCount = ((int)level.size() + FORMULA_CHUNK - 1) / FORMULA_CHUNK;
+            pool.parallelFor(chunkCount, [&](int chunk) {
+                size_t end = std::min(level.size(), (size_t)(chunk + 1) * FORMULA_CHUNK);
+                for (size_t i = (size_t)chunk * FORMULA_CHUNK; i < end; i++) {
+                    Formula& formula = formulas[order[level[i]]];
+                    formula.result = evaluate(formula);
+                }
+            });
+        } else {
+            for (int slot : level) {
+                Formula& formula = formulas[order[slot]];
+                formula.result = evaluate(formula);
+            }
+        }
+
+        nextLevel.clear();
+        for (int slot : level) {
+            sorted.push_back(slot);
+            for (int target : edges[slot]) {
+                if (--pending[target] == 0) {
+                    nextLevel.push_back(target);
+                }
+            }
+        }
+        level.swap(nextLevel);
+    }
+
+    // Whatever is left is on a cycle or downstream of one
+    for (size_t i = 0; i < order.size(); i++) {
+        if (pending[i] > 0) {
+            formulas[order[i]].result = Value();
+            formulas[order[i]].result.error = Error::CYCLE;
+            sorted.push_back((int)i);
+        }
+    }
+
+    writingResults = true;
+    for (int slot : sorted) {
+        writeResult(formulas[order[slot]]);
+    }
+    writingResults = false;
+
+    for (int id : order) {
+        dirtySlots[id] = -1;
+    }
+}
+
+void FormulaEngine::writeResult(const Formula& formula) {
+    if (formula.row >= model->getRowCount() || formula.col >= model->getColCount()) return;
+
+    std::string text = formula.result.error != Error::NONE ? getErrorText(formula.result.error)
+                                                           : ColumnarTableModel::formatDouble(formula.result.number);
+    // Typed models may refuse text such as errors; the cell is cleared instead
+    if (!model->setCellValue(formula.row, formula.col, text)) {
+        model->setCellValue(formula.row, formula.col, "");
+    }
+}
+
+void FormulaEngine::cellsChanged(int firstRow, int firstCol, int lastRow, int lastCol) {
+    if (writingResults || formulaAt.empty() || firstRow > lastRow || firstCol > lastCol) return;
+
+    std::vector<int> seeds;
+    collectDependents(firstRow, firstCol, lastRow, lastCol, seeds);
+    if (!seeds.empty()) {
+        recalculate(seeds);
+    }
+}
+
+void FormulaEngine::structureChanged() {
+    int rowCount = model->getRowCount();
+    int colCount = model->getColCount();
+    std::vector<std::pair<int, int>> removed;
+    for (const auto& entry : formulaAt) {
+        const Formula& formula = formulas[entry.second];
+        if (formula.row >= rowCount || formula.col >= colCount) {
+            removed.emplace_back(formula.row, formula.col);
+        }
+    }
+    for (const std::pair<int, int>& cell : removed) {
+        removeFormula(cell.first, cell.second);
+    }
+    recalculateAll();
+}
+
+void FormulaEngine::recalculateAll() {
+    std::vector<int> seeds;
+    seeds.reserve(formulaAt.size());
+    for (const auto& entry : formulaAt) {
+        seeds.push_back(entry.second);
+    }
+    if (!seeds.empty()) {
+        recalculate(seeds);
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef FORMULAENGINE_H
+#define FORMULAENGINE_H
+
+#include "TableModel.h"
+#include <cstdint>
+#include <unordered_map>
+
+// Spreadsheet formulas over the cells of a TableModel. A formula is text starting with
+// '=' using numbers, A1-style references (letters pick the column, the number is the
+// model row counting from 1), ranges such as A1:B10 as function arguments, + - * / ^,
+// comparisons (= <> < <= > >=) and SUM, AVERAGE, MIN, MAX, COUNT, ABS, SQRT, ROUND, IF.
+// Formulas are compiled to postfix code. Each result is written back into the model as
+// text, so views, sorting and export see values. The formula text stays in the engine.
+//
+// The engine keeps a reverse dependency index from cells to the formulas reading them.
+// When cells change, only formulas downstream of them are recalculated. They run in
+// topological levels, and the formulas within a level are evaluated in parallel.
+class FormulaEngine {
+public:
+    enum class Error : uint8_t { NONE, SYNTAX, VALUE, DIV0, REF, NUM, CYCLE };
+
+private:
+    struct Value {
+        double number = 0.0;
+        Error error = Error::NONE;
+        // Index into the formula's references when the value is a range argument
+        int range = -1;
+    };
+
+    enum class OpCode : uint8_t {
+        NUMBER, CELL, RANGE,
+        ADD, SUBTRACT, MULTIPLY, DIVIDE, POWER, NEGATE,
+        EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL,
+        CALL
+    };
+
+    struct Op {
+        OpCode code;
+        // Reference index for CELL and RANGE; function for CALL
+        int arg = 0;
+        int argCount = 0;
+        double number = 0.0;
+    };
+
+    struct Reference {
+        int firstRow, firstCol, lastRow, lastCol;
+    };
+
+    struct Formula {
+        int row = -1;
+        int col = -1;
+        std::string text;
+        std::vector<Op> code;
+        std::vector<Reference> references;
+        Value result;
+    };
+
+    struct RangeDependent {
+        int firstRow;
+        int lastRow;
+        int formula;
+    };
+
+    class Parser;
+
+    TableModel* model;
+    std::vector<Formula> formulas;
+    std::vector<int> freeFormulas;
+    // Position of each formula in the current recalculation, -1 when not dirty
+    std::vector<int> dirtySlots;
+    std::unordered_map<uint64_t, int> formulaAt;
+    // Formulas per column, so reading cells of columns without any skips the lookup
+    std::vector<int> columnFormulaCounts;
+
+    // Reverse dependencies: single-cell references by cell, ranges bucketed by column
+    std::unordered_map<uint64_t, std::vector<int>> cellDependents;
+    std::vector<std::vector<RangeDependent>> rangeDependents;
+    size_t cellReferenceCount;
+
+    // Set while results are written back, so the model's notifications are ignored
+    bool writingResults;
+
+    static uint64_t cellKey(int row, int col) { return ((uint64_t)(uint32_t)row << 32) | (uint32_t)col; }
+
+    void addDependencies(int id);
+    void removeDependencies(int id);
+    void collectDependents(int firstRow, int firstCol, int lastRow, int lastCol, std::vector<int>& out) const;
+
+    bool readCell(int row, int col, Value& value, bool skipText) const;
+    Value evaluateFunction(const Formula& formula, int function, const Value* args, int argCount) const;
+    Value evaluate(const Formula& formula) const;
+    void recalculate(std::vector<int>& seeds);
+    void writeResult(const Formula& formula);
+
+public:
+    // The model is not owned and must outlive the engine
+    explicit FormulaEngine(TableModel* model);
+
+    FormulaEngine(const FormulaEngine&) = delete;
+    FormulaEngine& operator=(const FormulaEngine&) = delete;
+
+    static bool isFormula(const std::string& text) { return text.size() > 1 && text[0] == '='; }
+    static const char* getErrorText(Error error);
+
+    // Compiles text as the formula of a cell and recalculates it and everything downstream.
+    // Returns false if the text does not parse. The formula is still kept, and the cell
+    // shows a syntax error.
+    bool setFormula(int row, int col, const std::string& text);
+    void removeFormula(int row, int col);
+    bool hasFormula(int row, int col) const;
+    std::string getFormula(int row, int col) const;
+    int getFormulaCount() const { return (int)formulaAt.size(); }
+    void clear();
+
+    // Recalculates the formulas downstream of a changed inclusive block of model cells
+    void cellsChanged(int firstRow, int firstCol, int lastRow, int lastCol);
+    // Drops formulas that no longer fit the model and recalculates the rest
+    void structureChanged();
+    void recalculateAll();
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "FrameCapture.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include <zlib.h>
+
+struct FrameCapture::SharedState {
+    std::atomic<int> pending{0};
+    std::atomic<int> written{0};
+    std::atomic<int> dropped{0};
+    std::atomic<int> failed{0};
+};
+
+FrameCapture::FrameCapture()
+    : state(std::make_shared<SharedState>()), screenshotLevel(6), screenshotPending(false),
+      frameLevel(1), continuous(false), frameNumber(0), frameInterval(0) {
+}
+
+FrameCapture::~FrameCapture() {
+}
+
+void FrameCapture::requestScreenshot(const std::string& filepath, int compressionLevel) {
+    screenshotPath = filepath;
+    screenshotLevel = std::max(-1, std::min(compressionLevel, 9));
+    screenshotPending = true;
+}
+
+void FrameCapture::startContinuous(const std::string& pathPrefix, double framesPerSecond, int compressionLevel) {
+    if (framesPerSecond <= 0.0) return;
+
+    framePrefix = pathPrefix;
+    frameLevel = std::max(-1, std::min(compressionLevel, 9));
+    frameNumber = 0;
+    frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / framesPerSecond));
+    nextFrameTime = std::chrono::steady_clock::now();
+    continuous = true;
+}
+
+void FrameCapture::stopContinuous() {
+    continuous = false;
+}
+
+int FrameCapture::getFramesWritten() const {
+    return state->written.load();
+}
+
+int FrameCapture::getFramesDropped() const {
+    return state->dropped.load();
+}
+
+int FrameCapture::getFramesFailed() const {
+    return state->failed.load();
+}
+
+void FrameCapture::onFrame(const uint32_t* buffer, int width, int height) {
+    if (screenshotPending) {
+        // Screenshots are explicit requests, so they are never dropped for backpressure
+        screenshotPending = false;
+        submit(buffer, width, height, screenshotPath, screenshotLevel, false);
+    }
+
+    if (!continuous) return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now < nextFrameTime) return;
+    nextFrameTime += frameInterval;
+    if (nextFrameTime < now) {
+        nextFrameTime = now + frameInterval;
+    }
+
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%06d.png", frameNumber++);
+    submit(buffer, width, height, framePrefix + suffix, frameLevel, true);
+}
+
+bool FrameCapture::submit(const uint32_t* buffer, int width, int height, const std::string& filepath,
+                          int compressionLevel, bool droppable) {
+    if (droppable && state->pending.load() >= MAX_PENDING_FRAMES) {
+        state->dropped++;
+        return false;
+    }
+
+    state->pending++;
+    std::shared_ptr<SharedState> shared = state;
+    auto pixels = std::make_shared<std::vector<uint32_t>>(buffer, buffer + (size_t)width * height);
+    WorkerPool::shared().submit([shared, pixels, filepath, width, height, compressionLevel]() {
+        if (writePNG(filepath, pixels->data(), width, height, compressionLevel)) {
+            shared->written++;
+        } else {
+            shared->failed++;
+        }
+        shared->pending--;
+    });
+    return true;
+}
+
+static void writeChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length) {
+    uint8_t header[8] = {
+        (uint8_t)(length >> 24), (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length,
+        (uint8_t)type[0], (uint8_t)type[1], (uint8_t)type[2], (uint8_t)type[3]
+    };
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    if (length > 0) {
+        crc = crc32(crc, data, length);
+    }
+    uint8_t footer[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+
+    std::fwrite(header, 1, 8, file);
+    if (length > 0) {
+        std::fwrite(data, 1, length, file);
+    }
+    std::fwrite(footer, 1, 4, file);
+}
+
+bool FrameCapture::writePNG(const std::string& filepath, const uint32_t* pixels, int width, int height,
+                            int compressionLevel) {
+    // The encoder is set up first, so an unusable level never leaves a file behind
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, compressionLevel) != Z_OK) {
+        std::cerr << "Failed to initialize zlib for capture file: " << filepath << std::endl;
+        return false;
+    }
+
+    FILE* file = std::fopen(filepath.c_str(), "wb");
+    if (!file) {
+        deflateEnd(&stream);
+        std::cerr << "Failed to open capture file: " << filepath << std::endl;
+        return false;
+    }
+
+    const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    std::fwrite(signature, 1, 8, file);
+
+    uint8_t ihdr[13] = {
+        (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+        (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+        8, 2, 0, 0, 0
+    };
+    writeChunk(file, "IHDR", ihdr, 13);
+
+    // Rows use the Sub filter, which suits flat UI colours, and stream straight into IDAT chunks
+    int stride = width * 3;
+    std::vector<uint8_t> row(stride + 1);
+    std::vector<uint8_t> output(1 << 16);
+    bool ok = true;
+
+    for (int y = 0; ok && y <= height; y++) {
+        int flush = Z_FINISH;
+        if (y < height) {
+            const uint32_t* src = &pixels[(size_t)y * width];
+            uint8_t* dst = &row[1];
+            row[0] = 1;
+            uint8_t prevR = 0, prevG = 0, prevB = 0;
+            for (int x = 0; x < width; x++) {
+                uint8_t r = (src[x] >> 16) & 0xFF;
+                uint8_t g = (src[x] >> 8) & 0xFF;
+                uint8_t b = src[x] & 0xFF;
+                dst[x * 3] = r - prevR;
+                dst[x * 3 + 1] = g - prevG;
+                dst[x * 3 + 2] = b - prevB;
+                prevR = r;
+                prevG = g;
+                prevB = b;
+            }
+            stream.next_in = row.data();
+            stream.avail_in = row.size();
+            flush = Z_NO_FLUSH;
+        }
+
+        int ret;
+        do {
+            stream.next_out = output.data();
+            stream.avail_out = output.size();
+            ret = deflate(&stream, flush);
+            if (ret == Z_STREAM_ERROR) {
+                ok = false;
+                break;
+            }
+            size_t have = output.size() - stream.avail_out;
+            if (have > 0) {
+                writeChunk(file, "IDAT", output.data(), (uint32_t)have);
+            }
+        } while (stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    }
+
+    deflateEnd(&stream);
+    writeChunk(file, "IEND", nullptr, 0);
+
+    ok = !std::ferror(file) && ok;
+    ok = (std::fclose(file) == 0) && ok;
+
+    // A partial PNG would look like a real frame to whoever collects the captures
+    if (!ok) {
+        std::cerr << "Failed to write capture file: " << filepath << std::endl;
+        std::remove(filepath.c_str());
+    }
+    return ok;
+}
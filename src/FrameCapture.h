@@ -0,0 +1,57 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <chrono>
+
+// Snapshots finished frames from the render loop and writes them as PNG files on the
+// shared worker pool. The render loop only pays for one copy of the framebuffer; when
+// the encoder falls behind, continuous-mode frames are dropped instead of queued.
+class FrameCapture {
+private:
+    struct SharedState;
+
+    std::shared_ptr<SharedState> state;
+    std::string screenshotPath;
+    int screenshotLevel;
+    bool screenshotPending;
+
+    std::string framePrefix;
+    int frameLevel;
+    bool continuous;
+    int frameNumber;
+    std::chrono::steady_clock::duration frameInterval;
+    std::chrono::steady_clock::time_point nextFrameTime;
+
+    bool submit(const uint32_t* buffer, int width, int height, const std::string& filepath, int compressionLevel,
+                bool droppable);
+
+public:
+    static constexpr int MAX_PENDING_FRAMES = 3;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    // Writes the next presented frame; compressionLevel is a zlib level (0-9, or -1 for
+    // zlib's default) and is clamped to that range
+    void requestScreenshot(const std::string& filepath, int compressionLevel = 6);
+    // Writes <pathPrefix>_000000.png, _000001.png, ... at up to framesPerSecond
+    void startContinuous(const std::string& pathPrefix, double framesPerSecond, int compressionLevel = 1);
+    void stopContinuous();
+    bool isContinuous() const { return continuous; }
+
+    // Called by the render loop with each finished frame
+    void onFrame(const uint32_t* buffer, int width, int height);
+
+    int getFramesWritten() const;
+    int getFramesDropped() const;
+    int getFramesFailed() const;
+
+    // Encodes 0xAARRGGBB pixels as an 8-bit RGB PNG; on failure no file is left behind
+    static bool writePNG(const std::string& filepath, const uint32_t* pixels, int width, int height,
+                         int compressionLevel);
+};
+
+#endif
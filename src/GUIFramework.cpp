@@ -7,6 +7,7 @@
 #include "TreeView.h"
 #include "TableGrid.h"
 #include "Canvas.h"
+#include "TiledImageView.h"
 #include <X11/Xlib.h>
 #include <fontconfig/fontconfig.h>
 #include <iostream>
@@ -28,6 +29,7 @@ GUIFramework::GUIFramework(const char* title, int width, int height)
       draggedTreeView(nullptr),
       draggedTableGrid(nullptr),
       draggedCanvas(nullptr),
+      draggedImageView(nullptr),
       loadedFontSize(12) {
 
     XInitThreads();
@@ -41,6 +43,7 @@ GUIFramework::GUIFramework(const char* title, int width, int height)
         mfb_set_resize_callback(window, resize_callback);
         mfb_set_mouse_button_callback(window, mouse_button_callback);
         mfb_set_mouse_move_callback(window, mouse_move_callback);
+        mfb_set_mouse_scroll_callback(window, mouse_scroll_callback);
         mfb_set_char_input_callback(window, char_callback);
         mfb_set_keyboard_callback(window, key_callback);
         mfb_set_close_callback(window, [](struct mfb_window*) -> bool {
@@ -128,6 +131,11 @@ void GUIFramework::mouse_move_callback(struct mfb_window* window, int x, int y)
     framework->handleMouseMove(x, y);
 }
 
+void GUIFramework::mouse_scroll_callback(struct mfb_window* window, mfb_key_mod /*mod*/, float /*deltaX*/, float deltaY) {
+    GUIFramework* framework = (GUIFramework*)mfb_get_user_data(window);
+    framework->handleMouseScroll(deltaY);
+}
+
 void GUIFramework::char_callback(struct mfb_window* window, unsigned int charCode) {
     GUIFramework* framework = (GUIFramework*)mfb_get_user_data(window);
     framework->handleChar(charCode);
@@ -262,6 +270,12 @@ void GUIFramework::handleWidgetMouseButton(Widget* widget, int mouseX, int mouse
             draggedCanvas = canvas;
             return;
         }
+        TiledImageView* imageView = dynamic_cast<TiledImageView*>(widget);
+        if (imageView && imageView->checkClick(mouseX, mouseY)) {
+            imageView->handleMouseButton(mouseX, mouseY, true);
+            draggedImageView = imageView;
+            return;
+        }
         ScrollBar* scrollBar = dynamic_cast<ScrollBar*>(widget);
         if (scrollBar && scrollBar->checkClick(mouseX, mouseY)) {
             scrollBar->handleMouseButton(mouseX, mouseY, true);
@@ -363,7 +377,8 @@ void GUIFramework::handleWidgetMouseButton(Widget* widget, int mouseX, int mouse
     }
 }
 
-void GUIFramework::handleMouseButton(mfb_mouse_button button, mfb_key_mod /*mod*/, bool isPressed) {
+void GUIFramework::handleMouseButton(mfb_mouse_button button, mfb_key_mod mod, bool isPressed) {
+    Widget::setKeyModifiers(mod);
     if (button == MOUSE_BTN_1) {
         if (isPressed) {
             bool widgetClicked = false;
@@ -493,6 +508,13 @@ void GUIFramework::handleMouseButton(mfb_mouse_button button, mfb_key_mod /*mod*
                         widgetClicked = true;
                         break;
                     }
+                    TiledImageView* imageView = dynamic_cast<TiledImageView*>(widget);
+                    if (imageView && imageView->checkClick(mouseX, mouseY)) {
+                        imageView->handleMouseButton(mouseX, mouseY, true);
+                        draggedImageView = imageView;
+                        widgetClicked = true;
+                        break;
+                    }
                     DropDownMenu* dropdown = dynamic_cast<DropDownMenu*>(widget);
                     if (dropdown) {
                         if (dropdown->checkClick(mouseX, mouseY)) {
@@ -566,6 +588,10 @@ void GUIFramework::handleMouseButton(mfb_mouse_button button, mfb_key_mod /*mod*
                 draggedCanvas->handleMouseButton(mouseX, mouseY, false);
                 draggedCanvas = nullptr;
             }
+            if (draggedImageView) {
+                draggedImageView->handleMouseButton(mouseX, mouseY, false);
+                draggedImageView = nullptr;
+            }
             if (draggedSplitter) {
                 draggedSplitter->handleMouseButton(mouseX, mouseY, false);
                 draggedSplitter = nullptr;
@@ -645,10 +671,40 @@ void GUIFramework::handleMouseMove(int x, int y) {
     if (draggedTreeView) draggedTreeView->handleMouseMove(mouseX, mouseY);
     if (draggedTableGrid) draggedTableGrid->handleMouseMove(mouseX, mouseY);
     if (draggedCanvas) draggedCanvas->handleMouseMove(mouseX, mouseY);
+    if (draggedImageView) draggedImageView->handleMouseMove(mouseX, mouseY);
     if (selectingTextBox) selectingTextBox->handleMouseMove(mouseX, mouseY);
     if (selectingMultiLineTextBox) selectingMultiLineTextBox->handleMouseMove(mouseX, mouseY);
 }
 
+void GUIFramework::handleMouseScroll(float deltaY) {
+    // Topmost widget under the cursor gets the wheel; widgets are drawn in insertion order
+    for (auto it = widgets.rbegin(); it != widgets.rend(); ++it) {
+        if (handleWidgetMouseWheel(*it, deltaY)) break;
+    }
+}
+
+bool GUIFramework::handleWidgetMouseWheel(Widget* widget, float delta) {
+    if (!widget->containsPoint(mouseX, mouseY)) return false;
+
+    std::vector<Widget*> children;
+    Panel* panel = dynamic_cast<Panel*>(widget);
+    if (panel) children = panel->getChildren();
+    TabbedPanel* tabbedPanel = dynamic_cast<TabbedPanel*>(widget);
+    if (tabbedPanel && tabbedPanel->getActivePanel()) children.push_back(tabbedPanel->getActivePanel());
+    Splitter* splitter = dynamic_cast<Splitter*>(widget);
+    if (splitter) {
+        children.push_back(splitter->getFirstPanel());
+        children.push_back(splitter->getSecondPanel());
+    }
+
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+        if (handleWidgetMouseWheel(*it, delta)) return true;
+    }
+
+    widget->handleMouseWheel(mouseX, mouseY, delta);
+    return true;
+}
+
 void GUIFramework::handleChar(unsigned int charCode) {
     if (focusedWidget && charCode >= 32 && charCode <= 126 && !keysPressed.empty()) {
         if (keysPressed.find(KB_KEY_LEFT_CONTROL) == keysPressed.end() &&
@@ -660,6 +716,7 @@ void GUIFramework::handleChar(unsigned int charCode) {
 }
 
 void GUIFramework::handleKey(mfb_key key, mfb_key_mod mod, bool isPressed) {
+    Widget::setKeyModifiers(mod);
     if (isPressed) {
         if (focusedWidget) {
             if ((mod & KB_MOD_CONTROL) && key == KB_KEY_C) {
@@ -744,6 +801,18 @@ void GUIFramework::setBackgroundColor(uint32_t color) {
     backgroundColor = color;
 }
 
+void GUIFramework::captureScreenshot(const std::string& filepath, int compressionLevel) {
+    frameCapture.requestScreenshot(filepath, compressionLevel);
+}
+
+void GUIFramework::startFrameCapture(const std::string& pathPrefix, double framesPerSecond, int compressionLevel) {
+    frameCapture.startContinuous(pathPrefix, framesPerSecond, compressionLevel);
+}
+
+void GUIFramework::stopFrameCapture() {
+    frameCapture.stopContinuous();
+}
+
 void GUIFramework::run() {
     if (!window) return;
     do {
@@ -793,6 +862,8 @@ void GUIFramework::run() {
             }
         }
 
+        frameCapture.onFrame(buffer, width, height);
+
         mfb_update_state state = mfb_update_ex(window, buffer, width, height);
         if (state != STATE_OK) break;
 
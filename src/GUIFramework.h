@@ -30,6 +30,8 @@
 #include "TreeView.h"
 #include "TableGrid.h"
 #include "Canvas.h"
+#include "TiledImageView.h"
+#include "FrameCapture.h"
 #include <vector>
 #include <string>
 #include <set>
@@ -52,6 +54,7 @@ private:
     TreeView* draggedTreeView;
     TableGrid* draggedTableGrid;
     Canvas* draggedCanvas;
+    TiledImageView* draggedImageView;
     std::vector<Widget*> widgets;
     std::vector<MenuBar*> menuBars;
     std::vector<StatusBar*> statusBars;
@@ -60,16 +63,19 @@ private:
     std::string loadedFontPath;
     int loadedFontSize;
     std::set<mfb_key> keysPressed;
+    FrameCapture frameCapture;
 
     static void resize_callback(struct mfb_window* window, int width, int height);
     static void mouse_button_callback(struct mfb_window* window, mfb_mouse_button button, mfb_key_mod mod, bool isPressed);
     static void mouse_move_callback(struct mfb_window* window, int x, int y);
+    static void mouse_scroll_callback(struct mfb_window* window, mfb_key_mod mod, float deltaX, float deltaY);
     static void char_callback(struct mfb_window* window, unsigned int charCode);
     static void key_callback(struct mfb_window* window, mfb_key key, mfb_key_mod mod, bool isPressed);
 
     void handleResize(int width, int height);
     void handleMouseButton(mfb_mouse_button button, mfb_key_mod mod, bool isPressed);
     void handleMouseMove(int x, int y);
+    void handleMouseScroll(float deltaY);
     void handleChar(unsigned int charCode);
     void handleKey(mfb_key key, mfb_key_mod mod, bool isPressed);
 
@@ -77,6 +83,7 @@ private:
     bool tryLoadFont(int size);
 
     void handleWidgetMouseButton(Widget* widget, int mouseX, int mouseY, bool isPressed);
+    bool handleWidgetMouseWheel(Widget* widget, float delta);
     Widget* getTargetWidget();
 
 public:
@@ -97,6 +104,12 @@ public:
     void pasteToTextBox();
     void selectAllInTextBox();
 
+    // PNG capture of presented frames; encoding happens off the UI thread
+    void captureScreenshot(const std::string& filepath, int compressionLevel = 6);
+    void startFrameCapture(const std::string& pathPrefix, double framesPerSecond, int compressionLevel = 1);
+    void stopFrameCapture();
+    FrameCapture& getFrameCapture() { return frameCapture; }
+
     void run();
 };
 
@@ -1,9 +1,16 @@
 #include "ImageLoader.h"
-#include <fstream>
+#include "PixelBlend.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
 #include <vector>
 #include <cstring>
 #include <zlib.h>
 #include <iostream>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 ImageLoader::ImageLoader() : pixelData(nullptr), width(0), height(0) {}
 
@@ -23,43 +30,95 @@ void ImageLoader::freePixelData() {
 bool ImageLoader::loadPNG(const char* filepath) {
     freePixelData();
 
-    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
+    MappedFile file;
+    if (!file.open(filepath)) {
         std::cerr << "Failed to open PNG file: " << filepath << std::endl;
         return false;
     }
 
-    std::streamsize fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
+    return parsePNG(file.getData(), file.getSize());
+}
 
-    std::vector<uint8_t> fileData(fileSize);
-    if (!file.read(reinterpret_cast<char*>(fileData.data()), fileSize)) {
-        std::cerr << "Failed to read PNG file" << std::endl;
+bool ImageLoader::loadGIF(const char* filepath) {
+    freePixelData();
+
+    MappedFile file;
+    if (!file.open(filepath)) {
+        std::cerr << "Failed to open GIF file: " << filepath << std::endl;
         return false;
     }
 
-    return parsePNG(fileData.data(), fileData.size());
+    return parseGIF(file.getData(), file.getSize());
 }
 
-bool ImageLoader::loadGIF(const char* filepath) {
+bool ImageLoader::parse(const uint8_t* data, size_t dataSize) {
+    return parse(data, dataSize, 0, RowSink());
+}
+
+bool ImageLoader::parse(const uint8_t* data, size_t dataSize, int bandRows, const RowSink& sink) {
     freePixelData();
+    bandRows = std::max(bandRows, 1);
 
-    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open GIF file: " << filepath << std::endl;
+    // Formats that cannot be streamed are decoded whole and handed to the sink afterwards
+    bool ok = false;
+    const uint8_t pngSignature[] = {137, 80, 78, 71, 13, 10, 26, 10};
+    if (dataSize >= 8 && std::memcmp(data, pngSignature, 8) == 0) {
+        ok = parsePNG(data, dataSize, bandRows, sink);
+    } else if (dataSize >= 6 && (std::memcmp(data, "GIF87a", 6) == 0 || std::memcmp(data, "GIF89a", 6) == 0)) {
+        ok = parseGIF(data, dataSize);
+    } else {
+        std::cerr << "Unrecognized image data" << std::endl;
+    }
+    if (ok && sink && pixelData) {
+        ok = emitBands(bandRows, sink);
+    }
+    return ok;
+}
+
+bool ImageLoader::emitBands(int bandRows, const RowSink& sink) {
+    bool ok = true;
+    for (int firstRow = 0; ok && firstRow < height; firstRow += bandRows) {
+        ok = sink(&pixelData[(size_t)firstRow * width], firstRow, std::min(bandRows, height - firstRow));
+    }
+    if (!ok) {
+        freePixelData();
         return false;
     }
+    delete[] pixelData;
+    pixelData = nullptr;
+    return true;
+}
 
-    std::streamsize fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
+bool ImageLoader::load(const char* filepath, int bandRows, const RowSink& sink) {
+    freePixelData();
 
-    std::vector<uint8_t> fileData(fileSize);
-    if (!file.read(reinterpret_cast<char*>(fileData.data()), fileSize)) {
-        std::cerr << "Failed to read GIF file" << std::endl;
+    MappedFile file;
+    if (!file.open(filepath)) {
+        std::cerr << "Failed to open image file: " << filepath << std::endl;
         return false;
     }
 
-    return parseGIF(fileData.data(), fileData.size());
+    return parse(file.getData(), file.getSize(), bandRows, sink);
+}
+
+bool ImageLoader::load(const char* filepath) {
+    std::string path(filepath);
+    if (path.size() >= 4) {
+        std::string ext = path.substr(path.size() - 4);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+        if (ext == ".png") {
+            return loadPNG(filepath);
+        } else if (ext == ".gif") {
+            return loadGIF(filepath);
+        }
+    }
+
+    if (loadPNG(filepath)) {
+        return true;
+    }
+
+    return loadGIF(filepath);
 }
 
 uint32_t ImageLoader::readBigEndian32(const uint8_t* data) {
@@ -70,123 +129,437 @@ uint16_t ImageLoader::readLittleEndian16(const uint8_t* data) {
     return data[0] | (data[1] << 8);
 }
 
-bool ImageLoader::decompressIDAT(const uint8_t* compressedData, size_t compressedSize,
-                                  uint8_t** decompressed, size_t* decompressedSize) {
-    z_stream stream;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    stream.avail_in = compressedSize;
-    stream.next_in = const_cast<uint8_t*>(compressedData);
-
-    if (inflateInit(&stream) != Z_OK) {
-        std::cerr << "Failed to initialize zlib" << std::endl;
-        return false;
+// Shared between the decoding thread, the unfilter thread and conversion jobs on the
+// worker pool. Jobs hold a reference, so the state outlives a decode they arrive too late for.
+struct ImageLoader::DecodePipeline {
+    std::mutex mutex;
+    std::condition_variable progress;
+    int totalRows = 0;
+    int inflatedRows = 0;
+    bool aborted = false;
+    bool unfilterDone = false;
+
+    // Bands below readyBands are unfiltered; nextBand is the first one nobody has claimed
+    int bandRows = 0;
+    int bandCount = 0;
+    int readyBands = 0;
+    int nextBand = 0;
+    int completedBands = 0;
+    std::function<void(int, int)> convertRows;
+
+    void convertBand(int band) {
+        int firstRow = band * bandRows;
+        convertRows(firstRow, std::min(firstRow + bandRows, totalRows));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            completedBands++;
+        }
+        progress.notify_all();
     }
 
-    std::vector<uint8_t> output;
-    uint8_t buffer[32768];
+    // Pool jobs convert whatever bands are ready and return; they never wait for more
+    void convertReadyBands() {
+        while (true) {
+            int band;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (nextBand >= readyBands) return;
+                band = nextBand++;
+            }
+            convertBand(band);
+        }
+    }
+};
 
-    int ret;
-    do {
-        stream.avail_out = sizeof(buffer);
-        stream.next_out = buffer;
-        ret = inflate(&stream, Z_NO_FLUSH);
+// Inflates the IDAT chunks on demand, feeding zlib from the source bytes instead of joining them first
+struct ImageLoader::IDATReader {
+    const std::vector<std::pair<const uint8_t*, size_t>>& chunks;
+    size_t nextChunk = 0;
+    z_stream stream;
+    bool initialized = false;
+    bool finished = false;
+
+    explicit IDATReader(const std::vector<std::pair<const uint8_t*, size_t>>& idatChunks) : chunks(idatChunks) {
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        stream.avail_in = 0;
+        stream.next_in = Z_NULL;
+        initialized = inflateInit(&stream) == Z_OK;
+        if (!initialized) {
+            std::cerr << "Failed to initialize zlib" << std::endl;
+        }
+    }
 
-        if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+    ~IDATReader() {
+        if (initialized) {
             inflateEnd(&stream);
-            std::cerr << "Zlib decompression error: " << ret << std::endl;
+        }
+    }
+
+    // Fills exactly size bytes, or fails on corrupt or truncated data
+    bool read(uint8_t* output, size_t size) {
+        if (!initialized) return false;
+
+        stream.next_out = output;
+        stream.avail_out = size;
+        while (stream.avail_out > 0 && !finished) {
+            if (stream.avail_in == 0) {
+                if (nextChunk == chunks.size()) break;
+                stream.next_in = const_cast<uint8_t*>(chunks[nextChunk].first);
+                stream.avail_in = chunks[nextChunk].second;
+                nextChunk++;
+                continue;
+            }
+
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                finished = true;
+            } else if (ret == Z_BUF_ERROR) {
+                break;
+            } else if (ret != Z_OK) {
+                std::cerr << "Zlib decompression error: " << ret << std::endl;
+                return false;
+            }
+        }
+
+        if (stream.avail_out > 0) {
+            std::cerr << "Truncated PNG image data" << std::endl;
             return false;
         }
+        return true;
+    }
+};
+
+bool ImageLoader::decompressIDAT(const std::vector<std::pair<const uint8_t*, size_t>>& chunks,
+                                  uint8_t* output, size_t outputSize,
+                                  const std::function<void(size_t)>& onProgress) {
+    // Inflate straight into the row buffer in slices so downstream stages can start early
+    IDATReader reader(chunks);
+    const size_t sliceSize = 65536;
+    size_t produced = 0;
+    while (produced < outputSize) {
+        size_t slice = std::min(outputSize - produced, sliceSize);
+        if (!reader.read(output + produced, slice)) return false;
+        produced += slice;
+        if (onProgress) {
+            onProgress(produced);
+        }
+    }
+    return true;
+}
 
-        size_t have = sizeof(buffer) - stream.avail_out;
-        output.insert(output.end(), buffer, buffer + have);
-    } while (ret != Z_STREAM_END);
+void ImageLoader::unfilterRow(uint8_t* row, const uint8_t* prior, int stride, int bytesPerPixel, uint8_t filterType) {
+    // One tight loop per filter type instead of a switch per byte
+    switch (filterType) {
+        case 0:
+            break;
+        case 1:
+            for (int x = bytesPerPixel; x < stride; x++) {
+                row[x] += row[x - bytesPerPixel];
+            }
+            break;
+        case 2:
+            for (int x = 0; x < stride; x++) {
+                row[x] += prior[x];
+            }
+            break;
+        case 3:
+            for (int x = 0; x < bytesPerPixel; x++) {
+                row[x] += prior[x] >> 1;
+            }
+            for (int x = bytesPerPixel; x < stride; x++) {
+                row[x] += (row[x - bytesPerPixel] + prior[x]) >> 1;
+            }
+            break;
+        case 4:
+            for (int x = 0; x < bytesPerPixel; x++) {
+                row[x] += prior[x];
+            }
+            for (int x = bytesPerPixel; x < stride; x++) {
+                int left = row[x - bytesPerPixel];
+                int above = prior[x];
+                int upperLeft = prior[x - bytesPerPixel];
+                int p = left + above - upperLeft;
+                int pa = abs(p - left);
+                int pb = abs(p - above);
+                int pc = abs(p - upperLeft);
+                if (pa <= pb && pa <= pc)
+                    row[x] += left;
+                else if (pb <= pc)
+                    row[x] += above;
+                else
+                    row[x] += upperLeft;
+            }
+            break;
+    }
+}
 
-    inflateEnd(&stream);
+void ImageLoader::unfilterPNG(uint8_t* imageData, int firstRow, int lastRow, int stride, int bytesPerPixel,
+                              const uint8_t* zeroRow) {
+    for (int y = firstRow; y < lastRow; y++) {
+        uint8_t* rowStart = &imageData[(size_t)y * (stride + 1)];
+        const uint8_t* prior = (y > 0) ? &imageData[(size_t)(y - 1) * (stride + 1) + 1] : zeroRow;
+        unfilterRow(rowStart + 1, prior, stride, bytesPerPixel, rowStart[0]);
+    }
+}
 
-    *decompressedSize = output.size();
-    *decompressed = new uint8_t[*decompressedSize];
-    std::memcpy(*decompressed, output.data(), *decompressedSize);
+template <int ColorType, int BitDepth>
+void ImageLoader::convertRow(const uint8_t* row, uint32_t* out, int count, const PNGFormat& format) {
+    if constexpr (ColorType == 0 && BitDepth < 8) {
+        // Packed grayscale, most significant bits first, scaled up to 8 bits
+        constexpr int mask = (1 << BitDepth) - 1;
+        constexpr int scale = 255 / mask;
+        for (int x = 0; x < count; x++) {
+            int bit = x * BitDepth;
+            int sample = (row[bit >> 3] >> (8 - BitDepth - (bit & 7))) & mask;
+            uint32_t v = sample * scale;
+            out[x] = (format.hasColorKey && sample == format.keyR) ? 0 : (0xFF000000 | (v << 16) | (v << 8) | v);
+        }
+    } else if constexpr (ColorType == 0) {
+        constexpr int step = BitDepth / 8;
+        for (int x = 0; x < count; x++) {
+            const uint8_t* p = &row[x * step];
+            uint32_t v = p[0];
+            if (format.hasColorKey) {
+                uint16_t sample = (step == 2) ? (uint16_t)((p[0] << 8) | p[1]) : p[0];
+                if (sample == format.keyR) {
+                    out[x] = 0;
+                    continue;
+                }
+            }
+            out[x] = 0xFF000000 | (v << 16) | (v << 8) | v;
+        }
+    } else if constexpr (ColorType == 2) {
+        constexpr int step = BitDepth / 8;
+        for (int x = 0; x < count; x++) {
+            const uint8_t* p = &row[x * step * 3];
+            if (format.hasColorKey) {
+                uint16_t r = (step == 2) ? (uint16_t)((p[0] << 8) | p[1]) : p[0];
+                uint16_t g = (step == 2) ? (uint16_t)((p[2] << 8) | p[3]) : p[step];
+                uint16_t b = (step == 2) ? (uint16_t)((p[4] << 8) | p[5]) : p[step * 2];
+                if (r == format.keyR && g == format.keyG && b == format.keyB) {
+                    out[x] = 0;
+                    continue;
+                }
+            }
+            out[x] = 0xFF000000 | (p[0] << 16) | (p[step] << 8) | p[step * 2];
+        }
+    } else if constexpr (ColorType == 3) {
+        constexpr int mask = (1 << BitDepth) - 1;
+        for (int x = 0; x < count; x++) {
+            int index;
+            if constexpr (BitDepth == 8) {
+                index = row[x];
+            } else {
+                int bit = x * BitDepth;
+                index = (row[bit >> 3] >> (8 - BitDepth - (bit & 7))) & mask;
+            }
+            out[x] = (index < format.paletteSize) ? format.palette[index] : 0xFF000000;
+        }
+    } else if constexpr (ColorType == 4) {
+        constexpr int step = BitDepth / 8;
+        for (int x = 0; x < count; x++) {
+            const uint8_t* p = &row[x * step * 2];
+            uint32_t v = p[0];
+            out[x] = premultiplyPixel(((uint32_t)p[step] << 24) | (v << 16) | (v << 8) | v);
+        }
+    } else if constexpr (ColorType == 6) {
+        constexpr int step = BitDepth / 8;
+        for (int x = 0; x < count; x++) {
+            const uint8_t* p = &row[x * step * 4];
+            out[x] = premultiplyPixel(((uint32_t)p[step * 3] << 24) | (p[0] << 16) | (p[step] << 8) | p[step * 2]);
+        }
+    }
+}
 
-    return true;
+ImageLoader::RowConverter ImageLoader::selectRowConverter(int colorType, int bitDepth) {
+    switch (colorType) {
+        case 0:
+            switch (bitDepth) {
+                case 1: return &convertRow<0, 1>;
+                case 2: return &convertRow<0, 2>;
+                case 4: return &convertRow<0, 4>;
+                case 8: return &convertRow<0, 8>;
+                case 16: return &convertRow<0, 16>;
+            }
+            break;
+        case 2:
+            if (bitDepth == 8) return &convertRow<2, 8>;
+            if (bitDepth == 16) return &convertRow<2, 16>;
+            break;
+        case 3:
+            switch (bitDepth) {
+                case 1: return &convertRow<3, 1>;
+                case 2: return &convertRow<3, 2>;
+                case 4: return &convertRow<3, 4>;
+                case 8: return &convertRow<3, 8>;
+            }
+            break;
+        case 4:
+            if (bitDepth == 8) return &convertRow<4, 8>;
+            if (bitDepth == 16) return &convertRow<4, 16>;
+            break;
+        case 6:
+            if (bitDepth == 8) return &convertRow<6, 8>;
+            if (bitDepth == 16) return &convertRow<6, 16>;
+            break;
+    }
+    return nullptr;
 }
 
-void ImageLoader::unfilterPNG(uint8_t* imageData, int width, int height, int bytesPerPixel) {
-    int stride = width * bytesPerPixel;
+void ImageLoader::convertToRGBA(const uint8_t* rawData, int stride, const PNGFormat& format, RowConverter converter,
+                                int firstRow, int lastRow) {
+    for (int y = firstRow; y < lastRow; y++) {
+        converter(&rawData[(size_t)y * (stride + 1) + 1], &pixelData[(size_t)y * width], width, format);
+    }
+}
 
-    for (int y = 0; y < height; y++) {
-        int rowOffset = y * (stride + 1);
-        uint8_t filterType = imageData[rowOffset];
-        uint8_t* row = &imageData[rowOffset + 1];
+bool ImageLoader::decodeStreamed(const std::vector<std::pair<const uint8_t*, size_t>>& idatChunks, int stride,
+                                 const PNGFormat& format, RowConverter converter, int bandRows, const RowSink& sink) {
+    // Raw rows of one band, after a slot holding the previous band's last row for the filters
+    // to refer to; it starts zeroed, which is what the first row's filter expects
+    size_t rowSize = (size_t)stride + 1;
+    std::vector<uint8_t> rawBand(rowSize * (bandRows + 1), 0);
+    std::vector<uint8_t> zeroRow(stride, 0);
+    std::vector<uint32_t> band((size_t)width * std::min(bandRows, height));
+    IDATReader reader(idatChunks);
+
+    for (int firstRow = 0; firstRow < height; firstRow += bandRows) {
+        int rowCount = std::min(bandRows, height - firstRow);
+        if (!reader.read(&rawBand[rowSize], rowSize * rowCount)) return false;
+
+        unfilterPNG(rawBand.data(), 1, rowCount + 1, stride, format.bytesPerPixel, zeroRow.data());
+        for (int y = 0; y < rowCount; y++) {
+            converter(&rawBand[(y + 1) * rowSize + 1], &band[(size_t)y * width], width, format);
+        }
+        if (!sink(band.data(), firstRow, rowCount)) return false;
 
-        for (int x = 0; x < stride; x++) {
-            uint8_t left = (x >= bytesPerPixel) ? row[x - bytesPerPixel] : 0;
-            uint8_t above = (y > 0) ? imageData[(y - 1) * (stride + 1) + 1 + x] : 0;
-            uint8_t upperLeft = (x >= bytesPerPixel && y > 0) ?
-                                imageData[(y - 1) * (stride + 1) + 1 + x - bytesPerPixel] : 0;
+        std::memcpy(rawBand.data(), &rawBand[rowCount * rowSize], rowSize);
+    }
+    return true;
+}
 
-            switch (filterType) {
-                case 0:
-                    break;
-                case 1:
-                    row[x] += left;
-                    break;
-                case 2:
-                    row[x] += above;
-                    break;
-                case 3:
-                    row[x] += (left + above) / 2;
-                    break;
-                case 4: {
-                    int p = left + above - upperLeft;
-                    int pa = abs(p - left);
-                    int pb = abs(p - above);
-                    int pc = abs(p - upperLeft);
-                    if (pa <= pb && pa <= pc)
-                        row[x] += left;
-                    else if (pb <= pc)
-                        row[x] += above;
-                    else
-                        row[x] += upperLeft;
-                    break;
-                }
+void ImageLoader::decodeInterlaced(uint8_t* rawData, const PNGFormat& format, RowConverter converter) {
+    // Adam7: seven reduced images, each with its own filtered rows, scattered into the full image
+    std::vector<uint32_t> passRow(width);
+    std::vector<uint8_t> zeroRow(((size_t)width * format.bitsPerPixel + 7) / 8, 0);
+    uint8_t* passData = rawData;
+
+    for (int pass = 0; pass < 7; pass++) {
+        int passWidth = (width - ADAM7_START_X[pass] + ADAM7_STEP_X[pass] - 1) / ADAM7_STEP_X[pass];
+        int passHeight = (height - ADAM7_START_Y[pass] + ADAM7_STEP_Y[pass] - 1) / ADAM7_STEP_Y[pass];
+        if (passWidth <= 0 || passHeight <= 0) continue;
+
+        int passStride = (int)(((size_t)passWidth * format.bitsPerPixel + 7) / 8);
+        unfilterPNG(passData, 0, passHeight, passStride, format.bytesPerPixel, zeroRow.data());
+
+        for (int py = 0; py < passHeight; py++) {
+            converter(&passData[(size_t)py * (passStride + 1) + 1], passRow.data(), passWidth, format);
+            uint32_t* out = &pixelData[(size_t)(ADAM7_START_Y[pass] + py * ADAM7_STEP_Y[pass]) * width];
+            for (int px = 0; px < passWidth; px++) {
+                out[ADAM7_START_X[pass] + px * ADAM7_STEP_X[pass]] = passRow[px];
             }
         }
+
+        passData += (size_t)(passStride + 1) * passHeight;
     }
 }
 
-void ImageLoader::convertToRGBA(const uint8_t* rawData, int colorType, int bitDepth) {
-    (void)bitDepth;
-
-    pixelData = new uint32_t[width * height];
-
-    int stride = width * (colorType == 6 ? 4 : 3);
-
-    for (int y = 0; y < height; y++) {
-        int rowOffset = y * (stride + 1) + 1;
-        for (int x = 0; x < width; x++) {
-            int pixelIdx = y * width + x;
-
-            if (colorType == 6) {
-                int dataIdx = rowOffset + x * 4;
-                uint8_t r = rawData[dataIdx];
-                uint8_t g = rawData[dataIdx + 1];
-                uint8_t b = rawData[dataIdx + 2];
-                uint8_t a = rawData[dataIdx + 3];
-                pixelData[pixelIdx] = (a << 24) | (r << 16) | (g << 8) | b;
-            } else if (colorType == 2) {
-                int dataIdx = rowOffset + x * 3;
-                uint8_t r = rawData[dataIdx];
-                uint8_t g = rawData[dataIdx + 1];
-                uint8_t b = rawData[dataIdx + 2];
-                pixelData[pixelIdx] = 0xFF000000 | (r << 16) | (g << 8) | b;
+bool ImageLoader::decodePipelined(const std::vector<std::pair<const uint8_t*, size_t>>& idatChunks,
+                                  uint8_t* rawData, int stride, const PNGFormat& format, RowConverter converter) {
+    int bytesPerPixel = format.bytesPerPixel;
+    size_t rowSize = (size_t)stride + 1;
+    std::vector<uint8_t> zeroRow(stride, 0);
+
+    std::shared_ptr<DecodePipeline> pipeline = std::make_shared<DecodePipeline>();
+    pipeline->totalRows = height;
+    pipeline->bandRows = std::max(16, (1 << 18) / std::max(width, 1));
+    pipeline->bandCount = (height + pipeline->bandRows - 1) / pipeline->bandRows;
+    pipeline->convertRows = [this, rawData, stride, &format, converter](int firstRow, int lastRow) {
+        convertToRGBA(rawData, stride, format, converter, firstRow, lastRow);
+    };
+
+    // Stage 2: rows are unfiltered in order as they come out of zlib. Each completed band
+    // becomes one conversion job (stage 3) on the pool.
+    WorkerPool& pool = WorkerPool::shared();
+    std::thread unfilterThread([this, pipeline, &pool, rawData, stride, bytesPerPixel, &zeroRow]() {
+        int row = 0;
+        while (row < height) {
+            int available;
+            {
+                std::unique_lock<std::mutex> lock(pipeline->mutex);
+                pipeline->progress.wait(lock, [&] { return pipeline->aborted || pipeline->inflatedRows > row; });
+                if (pipeline->aborted) break;
+                available = pipeline->inflatedRows;
             }
+
+            while (row < available) {
+                int batchEnd = std::min(row + 32, available);
+                unfilterPNG(rawData, row, batchEnd, stride, bytesPerPixel, zeroRow.data());
+                row = batchEnd;
+
+                int ready = (row == height) ? pipeline->bandCount : row / pipeline->bandRows;
+                int newBands;
+                {
+                    std::lock_guard<std::mutex> lock(pipeline->mutex);
+                    newBands = ready - pipeline->readyBands;
+                    pipeline->readyBands = ready;
+                }
+                for (int i = 0; i < newBands; i++) {
+                    pool.submit([pipeline]() { pipeline->convertReadyBands(); });
+                }
+                if (newBands > 0) {
+                    pipeline->progress.notify_all();
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pipeline->mutex);
+            pipeline->unfilterDone = true;
+        }
+        pipeline->progress.notify_all();
+    });
+
+    // Stage 1: inflate on this thread, publishing every completed row
+    bool ok = decompressIDAT(idatChunks, rawData, rowSize * height, [&](size_t produced) {
+        {
+            std::lock_guard<std::mutex> lock(pipeline->mutex);
+            pipeline->inflatedRows = (int)(produced / rowSize);
+        }
+        pipeline->progress.notify_all();
+    });
+
+    if (!ok) {
+        {
+            std::lock_guard<std::mutex> lock(pipeline->mutex);
+            pipeline->aborted = true;
         }
+        pipeline->progress.notify_all();
     }
+
+    // Convert bands alongside the pool until every band has been converted. This thread does
+    // not depend on the pool making progress, so a busy pool only slows the decode down.
+    while (true) {
+        int band;
+        {
+            std::unique_lock<std::mutex> lock(pipeline->mutex);
+            pipeline->progress.wait(lock, [&] {
+                return pipeline->nextBand < pipeline->readyBands ||
+                       (pipeline->unfilterDone && pipeline->completedBands == pipeline->nextBand);
+            });
+            if (pipeline->nextBand >= pipeline->readyBands) break;
+            band = pipeline->nextBand++;
+        }
+        pipeline->convertBand(band);
+    }
+    unfilterThread.join();
+
+    return ok;
 }
 
-bool ImageLoader::parsePNG(const uint8_t* data, size_t dataSize) {
+bool ImageLoader::parsePNG(const uint8_t* data, size_t dataSize, int bandRows, const RowSink& sink) {
     if (dataSize < 8) return false;
 
     const uint8_t pngSignature[] = {137, 80, 78, 71, 13, 10, 26, 10};
@@ -196,9 +569,11 @@ bool ImageLoader::parsePNG(const uint8_t* data, size_t dataSize) {
     }
 
     size_t offset = 8;
-    std::vector<uint8_t> idatData;
-    int colorType = 0;
-    int bitDepth = 0;
+    std::vector<std::pair<const uint8_t*, size_t>> idatChunks;
+    PNGFormat format = {};
+    format.colorType = -1;
+    const uint8_t* transparency = nullptr;
+    size_t transparencySize = 0;
 
     while (offset + 12 <= dataSize) {
         uint32_t chunkLength = readBigEndian32(data + offset);
@@ -214,10 +589,20 @@ bool ImageLoader::parsePNG(const uint8_t* data, size_t dataSize) {
             if (chunkLength < 13) return false;
             width = readBigEndian32(data + offset);
             height = readBigEndian32(data + offset + 4);
-            bitDepth = data[offset + 8];
-            colorType = data[offset + 9];
+            format.bitDepth = data[offset + 8];
+            format.colorType = data[offset + 9];
+            format.interlace = data[offset + 12];
+        } else if (std::strcmp(chunkType, "PLTE") == 0) {
+            format.paletteSize = std::min<int>(chunkLength / 3, 256);
+            for (int i = 0; i < format.paletteSize; i++) {
+                const uint8_t* entry = data + offset + i * 3;
+                format.palette[i] = 0xFF000000 | (entry[0] << 16) | (entry[1] << 8) | entry[2];
+            }
+        } else if (std::strcmp(chunkType, "tRNS") == 0) {
+            transparency = data + offset;
+            transparencySize = chunkLength;
         } else if (std::strcmp(chunkType, "IDAT") == 0) {
-            idatData.insert(idatData.end(), data + offset, data + offset + chunkLength);
+            idatChunks.emplace_back(data + offset, chunkLength);
         } else if (std::strcmp(chunkType, "IEND") == 0) {
             break;
         }
@@ -225,23 +610,83 @@ bool ImageLoader::parsePNG(const uint8_t* data, size_t dataSize) {
         offset += chunkLength + 4;
     }
 
-    if (width == 0 || height == 0 || idatData.empty()) {
-        std::cerr << "Invalid PNG data" << std::endl;
+    RowConverter converter = selectRowConverter(format.colorType, format.bitDepth);
+    if (width <= 0 || height <= 0 || idatChunks.empty() || !converter || format.interlace > 1) {
+        std::cerr << "Invalid or unsupported PNG data" << std::endl;
+        width = 0;
+        height = 0;
         return false;
     }
 
-    uint8_t* decompressed = nullptr;
-    size_t decompressedSize = 0;
-    if (!decompressIDAT(idatData.data(), idatData.size(), &decompressed, &decompressedSize)) {
-        return false;
+    static const int channelsForType[7] = {1, 0, 3, 1, 2, 0, 4};
+    format.bitsPerPixel = channelsForType[format.colorType] * format.bitDepth;
+    format.bytesPerPixel = std::max(1, format.bitsPerPixel / 8);
+
+    if (transparency) {
+        if (format.colorType == 3) {
+            for (int i = 0; i < format.paletteSize && i < (int)transparencySize; i++) {
+                format.palette[i] = premultiplyPixel((format.palette[i] & 0x00FFFFFF) | ((uint32_t)transparency[i] << 24));
+            }
+        } else if (format.colorType == 0 && transparencySize >= 2) {
+            format.hasColorKey = true;
+            format.keyR = (transparency[0] << 8) | transparency[1];
+        } else if (format.colorType == 2 && transparencySize >= 6) {
+            format.hasColorKey = true;
+            format.keyR = (transparency[0] << 8) | transparency[1];
+            format.keyG = (transparency[2] << 8) | transparency[3];
+            format.keyB = (transparency[4] << 8) | transparency[5];
+        }
     }
 
-    int bytesPerPixel = (colorType == 6) ? 4 : 3;
-    unfilterPNG(decompressed, width, height, bytesPerPixel);
-    convertToRGBA(decompressed, colorType, bitDepth);
+    int stride = (int)(((size_t)width * format.bitsPerPixel + 7) / 8);
+    if (sink && format.interlace == 0) {
+        bool ok = decodeStreamed(idatChunks, stride, format, converter, bandRows, sink);
+        if (!ok) {
+            freePixelData();
+        }
+        return ok;
+    }
 
-    delete[] decompressed;
-    return true;
+    size_t rawSize = (format.interlace == 1) ? getInterlacedSize(format) : ((size_t)stride + 1) * height;
+
+    uint8_t* rawData = new uint8_t[rawSize];
+    pixelData = new uint32_t[(size_t)width * height];
+
+    bool ok;
+    if (format.interlace == 0 && (size_t)width * height >= PARALLEL_DECODE_PIXELS &&
+        WorkerPool::shared().getThreadCount() > 1) {
+        ok = decodePipelined(idatChunks, rawData, stride, format, converter);
+    } else if (format.interlace == 0) {
+        std::vector<uint8_t> zeroRow(stride, 0);
+        ok = decompressIDAT(idatChunks, rawData, rawSize, nullptr);
+        if (ok) {
+            unfilterPNG(rawData, 0, height, stride, format.bytesPerPixel, zeroRow.data());
+            convertToRGBA(rawData, stride, format, converter, 0, height);
+        }
+    } else {
+        ok = decompressIDAT(idatChunks, rawData, rawSize, nullptr);
+        if (ok) {
+            decodeInterlaced(rawData, format, converter);
+        }
+    }
+
+    delete[] rawData;
+    if (!ok) {
+        freePixelData();
+    }
+    return ok;
+}
+
+size_t ImageLoader::getInterlacedSize(const PNGFormat& format) const {
+
+    size_t total = 0;
+    for (int pass = 0; pass < 7; pass++) {
+        int passWidth = (width - ADAM7_START_X[pass] + ADAM7_STEP_X[pass] - 1) / ADAM7_STEP_X[pass];
+        int passHeight = (height - ADAM7_START_Y[pass] + ADAM7_STEP_Y[pass] - 1) / ADAM7_STEP_Y[pass];
+        if (passWidth <= 0 || passHeight <= 0) continue;
+        total += (((size_t)passWidth * format.bitsPerPixel + 7) / 8 + 1) * passHeight;
+    }
+    return total;
 }
 
 bool ImageLoader::parseGIFColorTable(const uint8_t* data, int numColors, uint32_t* colorTable) {
@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <utility>
+#include <functional>
 
 class ImageLoader {
 public:
@@ -11,7 +14,22 @@ public:
 
     bool loadPNG(const char* filepath);
     bool loadGIF(const char* filepath);
+    // Picks the decoder from the file extension, falling back to trying each format
+    bool load(const char* filepath);
+    // Decodes a PNG or GIF held in memory (e.g. an embedded resource) without copying it
+    bool parse(const uint8_t* data, size_t dataSize);
 
+    // Receives decoded rows firstRow .. firstRow + rowCount - 1, getWidth() pixels apart and
+    // premultiplied like getPixelData(); returning false stops the decode
+    typedef std::function<bool(const uint32_t* rows, int firstRow, int rowCount)> RowSink;
+
+    // Decodes into bands of bandRows rows (the last may be shorter) handed to sink top to
+    // bottom, leaving getPixelData() empty. Non-interlaced PNGs are streamed and only ever
+    // hold one band; interlaced PNGs and GIFs are decoded whole, then handed over in bands.
+    bool load(const char* filepath, int bandRows, const RowSink& sink);
+    bool parse(const uint8_t* data, size_t dataSize, int bandRows, const RowSink& sink);
+
+    // Pixels are 0xAARRGGBB with colour premultiplied by alpha (see PixelBlend.h)
     uint32_t* getPixelData() const { return pixelData; }
     int getWidth() const { return width; }
     int getHeight() const { return height; }
@@ -23,16 +41,55 @@ private:
     int width;
     int height;
 
-    bool parsePNG(const uint8_t* data, size_t dataSize);
+    bool parsePNG(const uint8_t* data, size_t dataSize, int bandRows = 0, const RowSink& sink = RowSink());
     bool parseGIF(const uint8_t* data, size_t dataSize);
 
     uint32_t readBigEndian32(const uint8_t* data);
     uint16_t readLittleEndian16(const uint8_t* data);
 
-    bool decompressIDAT(const uint8_t* compressedData, size_t compressedSize,
-                        uint8_t** decompressed, size_t* decompressedSize);
-    void unfilterPNG(uint8_t* imageData, int width, int height, int bytesPerPixel);
-    void convertToRGBA(const uint8_t* rawData, int colorType, int bitDepth);
+    // Images at least this large are decoded as an inflate -> unfilter -> convert pipeline
+    static constexpr size_t PARALLEL_DECODE_PIXELS = 1 << 20;
+    struct DecodePipeline;
+    struct IDATReader;
+
+    struct PNGFormat {
+        int colorType;
+        int bitDepth;
+        int interlace;
+        int bitsPerPixel;
+        int bytesPerPixel;  // Filter unit: whole bytes per pixel, at least 1
+        uint32_t palette[256];  // Premultiplied, with tRNS alpha applied
+        int paletteSize;
+        bool hasColorKey;  // tRNS for grayscale/truecolour: one sample value is transparent
+        uint16_t keyR, keyG, keyB;
+    };
+
+    // One specialised routine per colour type/bit depth, picked once per image
+    typedef void (*RowConverter)(const uint8_t* row, uint32_t* out, int count, const PNGFormat& format);
+    template <int ColorType, int BitDepth>
+    static void convertRow(const uint8_t* row, uint32_t* out, int count, const PNGFormat& format);
+    static RowConverter selectRowConverter(int colorType, int bitDepth);
+
+    bool decompressIDAT(const std::vector<std::pair<const uint8_t*, size_t>>& chunks,
+                        uint8_t* output, size_t outputSize,
+                        const std::function<void(size_t)>& onProgress);
+    void unfilterRow(uint8_t* row, const uint8_t* prior, int stride, int bytesPerPixel, uint8_t filterType);
+    void unfilterPNG(uint8_t* imageData, int firstRow, int lastRow, int stride, int bytesPerPixel,
+                     const uint8_t* zeroRow);
+    void convertToRGBA(const uint8_t* rawData, int stride, const PNGFormat& format, RowConverter converter,
+                       int firstRow, int lastRow);
+    bool decodePipelined(const std::vector<std::pair<const uint8_t*, size_t>>& idatChunks,
+                         uint8_t* rawData, int stride, const PNGFormat& format, RowConverter converter);
+    bool decodeStreamed(const std::vector<std::pair<const uint8_t*, size_t>>& idatChunks, int stride,
+                        const PNGFormat& format, RowConverter converter, int bandRows, const RowSink& sink);
+    bool emitBands(int bandRows, const RowSink& sink);
+    void decodeInterlaced(uint8_t* rawData, const PNGFormat& format, RowConverter converter);
+    size_t getInterlacedSize(const PNGFormat& format) const;
+
+    static constexpr int ADAM7_START_X[7] = {0, 4, 0, 2, 0, 1, 0};
+    static constexpr int ADAM7_START_Y[7] = {0, 0, 4, 0, 2, 0, 1};
+    static constexpr int ADAM7_STEP_X[7] = {8, 8, 4, 4, 2, 2, 1};
+    static constexpr int ADAM7_STEP_Y[7] = {8, 8, 8, 4, 4, 2, 2};
 
     bool parseGIFColorTable(const uint8_t* data, int numColors, uint32_t* colorTable);
     bool parseGIFImageData(const uint8_t* data, size_t dataSize, size_t offset,
@@ -1,72 +1,133 @@
 #include "ImageWidget.h"
 #include <algorithm>
 #include <cstring>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include "WorkerPool.h"
+#include "PixelBlend.h"
+
+struct ImageWidget::AsyncLoadState {
+    std::mutex mutex;
+    std::atomic<uint64_t> generation{0};
+    ImageLoader* result = nullptr;
+    bool resultReady = false;
+};
 
 ImageWidget::ImageWidget(int x, int y, int width, int height)
     : Widget(x, y, width, height), imageLoader(nullptr), ownsLoader(false),
-      maintainAspectRatio(true), backgroundColor(0xFFE0E0E0) {
+      maintainAspectRatio(true), backgroundColor(0xFFE0E0E0), placeholderColor(0xFFD0D0D0),
+      asyncState(std::make_shared<AsyncLoadState>()), isLoadingAsync(false),
+      loadCallback(nullptr), scaledSource(nullptr), scaledSourceWidth(0), scaledSourceHeight(0),
+      scaledWidth(0), scaledHeight(0), scaledOpaque(true) {
 }
 
 ImageWidget::ImageWidget(int x, int y, int width, int height, const std::string& filepath)
     : Widget(x, y, width, height), imageLoader(nullptr), ownsLoader(true),
-      maintainAspectRatio(true), backgroundColor(0xFFE0E0E0) {
+      maintainAspectRatio(true), backgroundColor(0xFFE0E0E0), placeholderColor(0xFFD0D0D0),
+      asyncState(std::make_shared<AsyncLoadState>()), isLoadingAsync(false),
+      loadCallback(nullptr), scaledSource(nullptr), scaledSourceWidth(0), scaledSourceHeight(0),
+      scaledWidth(0), scaledHeight(0), scaledOpaque(true) {
     loadImage(filepath);
 }
 
 ImageWidget::~ImageWidget() {
+    cancelAsyncLoad();
+    releaseLoader();
+}
+
+void ImageWidget::releaseLoader() {
     if (ownsLoader && imageLoader) {
         delete imageLoader;
     }
+    imageLoader = nullptr;
+    ownsLoader = false;
+    invalidateScaledCache();
 }
 
-bool ImageWidget::loadImage(const std::string& filepath) {
-    if (ownsLoader && imageLoader) {
-        delete imageLoader;
+ImageLoader* ImageWidget::decodeFile(const std::string& filepath) {
+    ImageLoader* loader = new ImageLoader();
+    if (loader->load(filepath.c_str())) {
+        return loader;
     }
+    delete loader;
+    return nullptr;
+}
 
-    imageLoader = new ImageLoader();
-    ownsLoader = true;
+bool ImageWidget::loadImage(const std::string& filepath) {
+    cancelAsyncLoad();
+    releaseLoader();
+
+    imageLoader = decodeFile(filepath);
+    ownsLoader = imageLoader != nullptr;
+    return imageLoader != nullptr;
+}
+
+void ImageWidget::loadImageAsync(const std::string& filepath) {
+    cancelAsyncLoad();
+    releaseLoader();
 
-    if (filepath.size() >= 4) {
-        std::string ext = filepath.substr(filepath.size() - 4);
-        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    std::shared_ptr<AsyncLoadState> state = asyncState;
+    uint64_t generation = state->generation.load();
+    isLoadingAsync = true;
 
-        if (ext == ".png") {
-            return imageLoader->loadPNG(filepath.c_str());
-        } else if (ext == ".gif") {
-            return imageLoader->loadGIF(filepath.c_str());
+    WorkerPool::shared().submit([state, generation, filepath]() {
+        // Skip the decode entirely if a newer request superseded this one while queued
+        if (state->generation.load() != generation) return;
+
+        ImageLoader* loader = decodeFile(filepath);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->generation.load() != generation) {
+            delete loader;
+            return;
         }
-    }
+        state->result = loader;
+        state->resultReady = true;
+    });
+}
 
-    if (imageLoader->loadPNG(filepath.c_str())) {
-        return true;
-    }
+void ImageWidget::cancelAsyncLoad() {
+    std::lock_guard<std::mutex> lock(asyncState->mutex);
+    asyncState->generation++;
+    delete asyncState->result;
+    asyncState->result = nullptr;
+    asyncState->resultReady = false;
+    isLoadingAsync = false;
+}
+
+void ImageWidget::pollAsyncLoad() {
+    if (!isLoadingAsync) return;
 
-    if (imageLoader->loadGIF(filepath.c_str())) {
-        return true;
+    ImageLoader* loader = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(asyncState->mutex);
+        if (!asyncState->resultReady) return;
+        loader = asyncState->result;
+        asyncState->result = nullptr;
+        asyncState->resultReady = false;
     }
 
-    delete imageLoader;
-    imageLoader = nullptr;
-    ownsLoader = false;
-    return false;
+    isLoadingAsync = false;
+    imageLoader = loader;
+    ownsLoader = loader != nullptr;
+
+    if (loadCallback) {
+        loadCallback(loader != nullptr);
+    }
 }
 
 void ImageWidget::setImageLoader(ImageLoader* loader, bool takeOwnership) {
-    if (ownsLoader && imageLoader) {
-        delete imageLoader;
-    }
+    cancelAsyncLoad();
+    releaseLoader();
 
     imageLoader = loader;
     ownsLoader = takeOwnership;
 }
 
 void ImageWidget::clearImage() {
-    if (ownsLoader && imageLoader) {
-        delete imageLoader;
-    }
-    imageLoader = nullptr;
-    ownsLoader = false;
+    cancelAsyncLoad();
+    releaseLoader();
 }
 
 void ImageWidget::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
@@ -75,21 +136,31 @@ void ImageWidget::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
     int endX = std::min(absX + width, bufferWidth);
     int endY = std::min(absY + height, bufferHeight);
 
+    pollAsyncLoad();
+
+    uint32_t fillColor = isLoadingAsync ? placeholderColor : backgroundColor;
     for (int py = absY; py < endY; py++) {
         for (int px = absX; px < endX; px++) {
             if (px >= 0 && py >= 0) {
-                buffer[py * bufferWidth + px] = backgroundColor;
+                buffer[py * bufferWidth + px] = fillColor;
             }
         }
     }
 
+    if (isLoadingAsync && fontRenderer) {
+        std::string label = "Loading...";
+        int textX = absX + (width - fontRenderer->getTextWidth(label)) / 2;
+        int textY = absY + (height + fontRenderer->getTextHeight()) / 2;
+        fontRenderer->drawText(buffer, bufferWidth, bufferHeight, label, textX, textY, 0xFF606060);
+        return;
+    }
+
     if (!imageLoader || !imageLoader->getPixelData()) {
         return;
     }
 
     int imgWidth = imageLoader->getWidth();
     int imgHeight = imageLoader->getHeight();
-    uint32_t* imgData = imageLoader->getPixelData();
 
     int drawWidth = width;
     int drawHeight = height;
@@ -111,44 +182,169 @@ void ImageWidget::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
         }
     }
 
-    for (int py = 0; py < drawHeight; py++) {
-        for (int px = 0; px < drawWidth; px++) {
-            int screenX = absX + offsetX + px;
-            int screenY = absY + offsetY + py;
+    if (drawWidth <= 0 || drawHeight <= 0) {
+        return;
+    }
 
-            if (screenX >= absX && screenX < endX && screenY >= absY && screenY < endY &&
-                screenX >= 0 && screenY >= 0 && screenX < bufferWidth && screenY < bufferHeight) {
+    if (scaledSource != imageLoader->getPixelData() || scaledSourceWidth != imgWidth ||
+        scaledSourceHeight != imgHeight || scaledWidth != drawWidth || scaledHeight != drawHeight) {
+        rebuildScaledCache(drawWidth, drawHeight);
+    }
 
-                int imgX = (px * imgWidth) / drawWidth;
-                int imgY = (py * imgHeight) / drawHeight;
+    // Clip the scaled image against the widget and the framebuffer once, then copy whole rows
+    int imageX = absX + offsetX;
+    int imageY = absY + offsetY;
+    int startX = std::max({imageX, absX, 0});
+    int startY = std::max({imageY, absY, 0});
+    int stopX = std::min(imageX + drawWidth, endX);
+    int stopY = std::min(imageY + drawHeight, endY);
+    if (startX >= stopX || startY >= stopY) {
+        return;
+    }
 
-                if (imgX >= 0 && imgX < imgWidth && imgY >= 0 && imgY < imgHeight) {
-                    uint32_t pixel = imgData[imgY * imgWidth + imgX];
-                    uint8_t alpha = (pixel >> 24) & 0xFF;
+    int spanWidth = stopX - startX;
+    for (int py = startY; py < stopY; py++) {
+        const uint32_t* src = &scaledPixels[(py - imageY) * drawWidth + (startX - imageX)];
+        uint32_t* dst = &buffer[py * bufferWidth + startX];
 
-                    if (alpha == 255) {
-                        buffer[screenY * bufferWidth + screenX] = pixel;
-                    } else if (alpha > 0) {
-                        uint32_t bgPixel = buffer[screenY * bufferWidth + screenX];
+        if (scaledOpaque) {
+            std::memcpy(dst, src, spanWidth * sizeof(uint32_t));
+            continue;
+        }
 
-                        uint8_t srcR = (pixel >> 16) & 0xFF;
-                        uint8_t srcG = (pixel >> 8) & 0xFF;
-                        uint8_t srcB = pixel & 0xFF;
+        for (int px = 0; px < spanWidth; px++) {
+            dst[px] = blendPremultiplied(src[px], dst[px]);
+        }
+    }
+}
+
+void ImageWidget::buildFilterTaps(int srcSize, int dstSize, std::vector<int>& firstTap,
+                                  std::vector<int>& tapCount, std::vector<float>& weights, int& maxTaps) {
+    double scale = (double)srcSize / (double)dstSize;
 
-                        uint8_t bgR = (bgPixel >> 16) & 0xFF;
-                        uint8_t bgG = (bgPixel >> 8) & 0xFF;
-                        uint8_t bgB = bgPixel & 0xFF;
+    // Area filter when shrinking, bilinear when enlarging
+    maxTaps = scale > 1.0 ? (int)std::ceil(scale) + 1 : 2;
+    firstTap.assign(dstSize, 0);
+    tapCount.assign(dstSize, 0);
+    weights.assign((size_t)dstSize * maxTaps, 0.0f);
 
-                        float a = alpha / 255.0f;
-                        uint8_t finalR = (uint8_t)(srcR * a + bgR * (1 - a));
-                        uint8_t finalG = (uint8_t)(srcG * a + bgG * (1 - a));
-                        uint8_t finalB = (uint8_t)(srcB * a + bgB * (1 - a));
+    for (int i = 0; i < dstSize; i++) {
+        float* w = &weights[(size_t)i * maxTaps];
 
-                        buffer[screenY * bufferWidth + screenX] =
-                            0xFF000000 | (finalR << 16) | (finalG << 8) | finalB;
-                    }
+        if (scale > 1.0) {
+            double lo = i * scale;
+            double hi = std::min((i + 1) * scale, (double)srcSize);
+            int first = (int)std::floor(lo);
+            int last = std::min((int)std::ceil(hi), srcSize);
+            int count = std::min(last - first, maxTaps);
+            double total = 0.0;
+            for (int t = 0; t < count; t++) {
+                double overlap = std::min(hi, (double)(first + t + 1)) - std::max(lo, (double)(first + t));
+                w[t] = (float)std::max(overlap, 0.0);
+                total += w[t];
+            }
+            for (int t = 0; t < count && total > 0.0; t++) {
+                w[t] = (float)(w[t] / total);
+            }
+            firstTap[i] = first;
+            tapCount[i] = count;
+        } else {
+            double center = (i + 0.5) * scale - 0.5;
+            int first = (int)std::floor(center);
+            float frac = (float)(center - first);
+            if (first < 0) {
+                first = 0;
+                frac = 0.0f;
+            }
+            if (first >= srcSize - 1) {
+                first = srcSize - 1;
+                frac = 0.0f;
+            }
+            w[0] = 1.0f - frac;
+            w[1] = frac;
+            firstTap[i] = first;
+            tapCount[i] = (frac > 0.0f) ? 2 : 1;
+        }
+    }
+}
+
+void ImageWidget::rebuildScaledCache(int drawWidth, int drawHeight) {
+    int srcWidth = imageLoader->getWidth();
+    int srcHeight = imageLoader->getHeight();
+    const uint32_t* src = imageLoader->getPixelData();
+
+    std::vector<int> firstX, countX, firstY, countY;
+    std::vector<float> weightsX, weightsY;
+    int tapsX = 0;
+    int tapsY = 0;
+    buildFilterTaps(srcWidth, drawWidth, firstX, countX, weightsX, tapsX);
+    buildFilterTaps(srcHeight, drawHeight, firstY, countY, weightsY, tapsY);
+
+    // Source pixels are premultiplied, so filtering channels independently does not bleed colour
+    // out of transparent regions. Output rows only reach tapsY source rows, and firstY never
+    // decreases, so horizontally filtered rows are kept in a ring of tapsY rows (row sy in slot
+    // sy % tapsY) rather than for the whole source.
+    std::vector<float> rows((size_t)drawWidth * tapsY * 4);
+    int filteredRows = 0;
+
+    scaledPixels.resize((size_t)drawWidth * drawHeight);
+    scaledOpaque = true;
+    for (int dy = 0; dy < drawHeight; dy++) {
+        filteredRows = std::max(filteredRows, firstY[dy]);
+        for (; filteredRows < firstY[dy] + countY[dy]; filteredRows++) {
+            const uint32_t* srcRow = &src[(size_t)filteredRows * srcWidth];
+            float* out = &rows[(size_t)(filteredRows % tapsY) * drawWidth * 4];
+            for (int dx = 0; dx < drawWidth; dx++) {
+                const float* w = &weightsX[(size_t)dx * tapsX];
+                float a = 0.0f, r = 0.0f, g = 0.0f, b = 0.0f;
+                for (int t = 0; t < countX[dx]; t++) {
+                    uint32_t pixel = srcRow[firstX[dx] + t];
+                    a += ((pixel >> 24) & 0xFF) * w[t];
+                    r += ((pixel >> 16) & 0xFF) * w[t];
+                    g += ((pixel >> 8) & 0xFF) * w[t];
+                    b += (pixel & 0xFF) * w[t];
                 }
+                out[dx * 4] = a;
+                out[dx * 4 + 1] = r;
+                out[dx * 4 + 2] = g;
+                out[dx * 4 + 3] = b;
             }
         }
+
+        const float* w = &weightsY[(size_t)dy * tapsY];
+        for (int dx = 0; dx < drawWidth; dx++) {
+            float a = 0.0f, r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int t = 0; t < countY[dy]; t++) {
+                const float* in = &rows[((size_t)((firstY[dy] + t) % tapsY) * drawWidth + dx) * 4];
+                a += in[0] * w[t];
+                r += in[1] * w[t];
+                g += in[2] * w[t];
+                b += in[3] * w[t];
+            }
+
+            uint32_t outA = (uint32_t)std::min(a + 0.5f, 255.0f);
+            uint32_t outR = (uint32_t)std::min(r + 0.5f, (float)outA);
+            uint32_t outG = (uint32_t)std::min(g + 0.5f, (float)outA);
+            uint32_t outB = (uint32_t)std::min(b + 0.5f, (float)outA);
+            uint32_t pixel = (outA << 24) | (outR << 16) | (outG << 8) | outB;
+            if ((pixel >> 24) != 0xFF) {
+                scaledOpaque = false;
+            }
+            scaledPixels[(size_t)dy * drawWidth + dx] = pixel;
+        }
     }
+
+    scaledSource = src;
+    scaledSourceWidth = srcWidth;
+    scaledSourceHeight = srcHeight;
+    scaledWidth = drawWidth;
+    scaledHeight = drawHeight;
+}
+
+void ImageWidget::invalidateScaledCache() {
+    scaledPixels.clear();
+    scaledPixels.shrink_to_fit();
+    scaledSource = nullptr;
+    scaledWidth = 0;
+    scaledHeight = 0;
 }
@@ -4,13 +4,41 @@
 #include "Widget.h"
 #include "ImageLoader.h"
 #include <string>
+#include <vector>
+#include <memory>
+#include <functional>
 
 class ImageWidget : public Widget {
 private:
+    struct AsyncLoadState;
+
     ImageLoader* imageLoader;
     bool ownsLoader;
     bool maintainAspectRatio;
     uint32_t backgroundColor;
+    uint32_t placeholderColor;
+
+    // Background decode state shared with worker jobs (which may outlive the widget)
+    std::shared_ptr<AsyncLoadState> asyncState;
+    bool isLoadingAsync;
+    std::function<void(bool)> loadCallback;
+
+    // Resampled copy of the image at the current draw size
+    std::vector<uint32_t> scaledPixels;
+    const uint32_t* scaledSource;
+    int scaledSourceWidth;
+    int scaledSourceHeight;
+    int scaledWidth;
+    int scaledHeight;
+    bool scaledOpaque;
+
+    static ImageLoader* decodeFile(const std::string& filepath);
+    void releaseLoader();
+    void cancelAsyncLoad();
+    void pollAsyncLoad();
+    void rebuildScaledCache(int drawWidth, int drawHeight);
+    static void buildFilterTaps(int srcSize, int dstSize, std::vector<int>& firstTap,
+                                std::vector<int>& tapCount, std::vector<float>& weights, int& maxTaps);
 
 public:
     ImageWidget(int x, int y, int width, int height);
@@ -20,14 +48,22 @@ public:
     void draw(uint32_t* buffer, int bufferWidth, int bufferHeight) override;
 
     bool loadImage(const std::string& filepath);
+    // Decodes on the shared worker pool; the placeholder is shown until the pixels are
+    // adopted on the UI thread. A newer load (sync or async) cancels any pending one.
+    void loadImageAsync(const std::string& filepath);
     void setImageLoader(ImageLoader* loader, bool takeOwnership = false);
     void clearImage();
+    // Call after modifying the loader's pixel data in place to force a rescale
+    void invalidateScaledCache();
 
     void setMaintainAspectRatio(bool maintain) { maintainAspectRatio = maintain; }
     void setBackgroundColor(uint32_t color) { backgroundColor = color; }
+    void setPlaceholderColor(uint32_t color) { placeholderColor = color; }
+    void setLoadCallback(std::function<void(bool)> callback) { loadCallback = callback; }
 
     ImageLoader* getImageLoader() const { return imageLoader; }
     bool hasImage() const { return imageLoader && imageLoader->getPixelData(); }
+    bool isLoading() const { return isLoadingAsync; }
 };
 
 #endif
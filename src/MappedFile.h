@@ -0,0 +1,29 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Pages are shared with the kernel page
+// cache, so no copy of the file contents is made in the process.
+class MappedFile {
+private:
+    const uint8_t* mappedData;
+    size_t mappedSize;
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* filepath);
+    void close();
+
+    const uint8_t* getData() const { return mappedData; }
+    size_t getSize() const { return mappedSize; }
+    bool isOpen() const { return mappedData != nullptr; }
+};
+
+#endif
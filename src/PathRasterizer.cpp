@@ -0,0 +1,361 @@
+#include "PathRasterizer.h"
+#include "PixelBlend.h"
+#include <algorithm>
+#include <cmath>
+
+static const float FLATTEN_TOLERANCE = 0.25f;
+static const int MAX_CURVE_SEGMENTS = 256;
+
+void CanvasPath::beginContourIfNeeded() {
+    if (contourEnds.empty() || contourEnds.back() != (int)points.size()) return;
+    // The last contour is finished; continue from its end point
+    Point last = points.back();
+    if (contourClosed.back()) {
+        last = points[contourEnds.size() > 1 ? contourEnds[contourEnds.size() - 2] : 0];
+    }
+    moveTo(last.x, last.y);
+}
+
+void CanvasPath::moveTo(float x, float y) {
+    // A lone moveTo replaces the previous one instead of leaving an empty contour
+    if (!contourEnds.empty() && contourEnds.back() == (int)points.size()) {
+        int contourStart = contourEnds.size() > 1 ? contourEnds[contourEnds.size() - 2] : 0;
+        if ((int)points.size() - contourStart == 1) {
+            points.back() = {x, y};
+            contourClosed.back() = false;
+            return;
+        }
+    }
+    points.push_back({x, y});
+    contourEnds.push_back((int)points.size());
+    contourClosed.push_back(false);
+}
+
+void CanvasPath::lineTo(float x, float y) {
+    if (points.empty()) {
+        moveTo(x, y);
+        return;
+    }
+    if (contourClosed.back()) beginContourIfNeeded();
+    points.push_back({x, y});
+    contourEnds.back() = (int)points.size();
+}
+
+void CanvasPath::quadTo(float controlX, float controlY, float x, float y) {
+    if (points.empty()) moveTo(controlX, controlY);
+    if (contourClosed.back()) beginContourIfNeeded();
+
+    Point p0 = points.back();
+    float ddx = p0.x - 2.0f * controlX + x;
+    float ddy = p0.y - 2.0f * controlY + y;
+    // Uniform subdivision deviates at most |p0 - 2p1 + p2| / (4n^2) from the curve
+    float deviation = std::sqrt(ddx * ddx + ddy * ddy);
+    int segments = (int)std::ceil(std::sqrt(deviation / (4.0f * FLATTEN_TOLERANCE)));
+    segments = std::min(std::max(segments, 1), MAX_CURVE_SEGMENTS);
+
+    for (int i = 1; i <= segments; i++) {
+        float t = (float)i / segments;
+        float mt = 1.0f - t;
+        points.push_back({mt * mt * p0.x + 2.0f * mt * t * controlX + t * t * x,
+                          mt * mt * p0.y + 2.0f * mt * t * controlY + t * t * y});
+    }
+    contourEnds.back() = (int)points.size();
+}
+
+void CanvasPath::cubicTo(float control1X, float control1Y, float control2X, float control2Y, float x, float y) {
+    if (points.empty()) moveTo(control1X, control1Y);
+    if (contourClosed.back()) beginContourIfNeeded();
+
+    Point p0 = points.back();
+    float dd1x = p0.x - 2.0f * control1X + control2X;
+    float dd1y = p0.y - 2.0f * control1Y + control2Y;
+    float dd2x = control1X - 2.0f * control2X + x;
+    float dd2y = control1Y - 2.0f * control2Y + y;
+    float deviation = std::sqrt(std::max(dd1x * dd1x + dd1y * dd1y, dd2x * dd2x + dd2y * dd2y));
+    int segments = (int)std::ceil(std::sqrt(3.0f * deviation / (4.0f * FLATTEN_TOLERANCE)));
+    segments = std::min(std::max(segments, 1), MAX_CURVE_SEGMENTS);
+
+    for (int i = 1; i <= segments; i++) {
+        float t = (float)i / segments;
+        float mt = 1.0f - t;
+        float a = mt * mt * mt;
+        float b = 3.0f * mt * mt * t;
+        float c = 3.0f * mt * t * t;
+        float d = t * t * t;
+        points.push_back({a * p0.x + b * control1X + c * control2X + d * x,
+                          a * p0.y + b * control1Y + c * control2Y + d * y});
+    }
+    contourEnds.back() = (int)points.size();
+}
+
+void CanvasPath::close() {
+    if (!contourClosed.empty()) {
+        contourClosed.back() = true;
+    }
+}
+
+void CanvasPath::clear() {
+    points.clear();
+    contourEnds.clear();
+    contourClosed.clear();
+}
+
+PathRasterizer::PathRasterizer()
+    : clipLeft(0), clipTop(0), clipRight(-1), clipBottom(-1), offsetX(0.0f), offsetY(0.0f) {
+}
+
+void PathRasterizer::reset(int left, int top, int right, int bottom, float offsetX, float offsetY) {
+    cells.clear();
+    this->offsetX = offsetX;
+    this->offsetY = offsetY;
+    clipLeft = left;
+    clipTop = top;
+    clipRight = right;
+    clipBottom = bottom;
+}
+
+void PathRasterizer::addCell(int x, int y, float cover, float area) {
+    // Consecutive pieces of one edge usually land in the same cell
+    if (!cells.empty() && cells.back().x == x && cells.back().y == y) {
+        cells.back().cover += cover;
+        cells.back().area += area;
+        return;
+    }
+    cells.push_back({x, y, cover, area});
+}
+
+void PathRasterizer::addRowPiece(int row, float x0, float x1, float dy) {
+    int cell0 = (int)std::floor(x0);
+    int cell1 = (int)std::floor(x1);
+    if (cell0 == cell1) {
+        addCell(cell0, row, dy, dy * ((x0 + x1) * 0.5f - cell0));
+        return;
+    }
+
+    // Split the piece at each pixel boundary, sharing dy by horizontal length
+    float left = std::min(x0, x1);
+    float right = std::max(x0, x1);
+    float dyPerX = dy / (right - left);
+    int firstCell = (int)std::floor(left);
+    int lastCell = (int)std::ceil(right) - 1;
+    for (int cell = firstCell; cell <= lastCell; cell++) {
+        float a = std::max(left, (float)cell);
+        float b = std::min(right, (float)(cell + 1));
+        float pieceDy = (b - a) * dyPerX;
+        addCell(cell, row, pieceDy, pieceDy * ((a + b) * 0.5f - cell));
+    }
+}
+
+void PathRasterizer::addClippedLine(float x0, float y0, float x1, float y1) {
+    float top = std::min(y0, y1);
+    float bottom = std::max(y0, y1);
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float direction = y1 > y0 ? 1.0f : -1.0f;
+
+    int firstRow = (int)std::floor(top);
+    for (int row = firstRow; row < bottom; row++) {
+        float a = std::max(top, (float)row);
+        float b = std::min(bottom, (float)(row + 1));
+        if (b <= a) continue;
+        float xa = x0 + (a - y0) * dxdy;
+        float xb = x0 + (b - y0) * dxdy;
+        addRowPiece(row, xa, xb, (b - a) * direction);
+    }
+}
+
+void PathRasterizer::addLine(float x0, float y0, float x1, float y1) {
+    if (y0 == y1 || !std::isfinite(x0 + y0 + x1 + y1)) return;
+    x0 += offsetX;
+    y0 += offsetY;
+    x1 += offsetX;
+    y1 += offsetY;
+
+    // Rows outside the clip rectangle contribute nothing
+    float minY = (float)clipTop;
+    float maxY = (float)(clipBottom + 1);
+    if (std::max(y0, y1) <= minY || std::min(y0, y1) >= maxY) return;
+    if (y0 < minY || y0 > maxY || y1 < minY || y1 > maxY) {
+        float dxdy = (x1 - x0) / (y1 - y0);
+        if (y0 < minY) { x0 += (minY - y0) * dxdy; y0 = minY; }
+        else if (y0 > maxY) { x0 += (maxY - y0) * dxdy; y0 = maxY; }
+        if (y1 < minY) { x1 += (minY - y1) * dxdy; y1 = minY; }
+        else if (y1 > maxY) { x1 += (maxY - y1) * dxdy; y1 = maxY; }
+        if (y0 == y1) return;
+    }
+
+    // Right of the clip rectangle only affects pixels that are not drawn. Left of it,
+    // an edge only adds cover to the pixels to its right, so it is folded onto the
+    // left boundary as a vertical edge.
+    float minX = (float)clipLeft;
+    float maxX = (float)(clipRight + 1);
+    if (x0 >= maxX && x1 >= maxX) return;
+    if ((x0 > maxX) != (x1 > maxX)) {
+        float ym = y0 + (maxX - x0) * (y1 - y0) / (x1 - x0);
+        if (x0 > maxX) {
+            x0 = maxX;
+            y0 = ym;
+        } else {
+            x1 = maxX;
+            y1 = ym;
+        }
+        if (y0 == y1) return;
+    }
+    if (x0 <= minX && x1 <= minX) {
+        addClippedLine(minX, y0, minX, y1);
+        return;
+    }
+    if ((x0 < minX) != (x1 < minX)) {
+        float ym = y0 + (minX - x0) * (y1 - y0) / (x1 - x0);
+        if (x0 < minX) {
+            if (ym != y0) addClippedLine(minX, y0, minX, ym);
+            x0 = minX;
+            y0 = ym;
+        } else {
+            if (ym != y1) addClippedLine(minX, ym, minX, y1);
+            x1 = minX;
+            y1 = ym;
+        }
+        if (y0 == y1) return;
+    }
+    addClippedLine(x0, y0, x1, y1);
+}
+
+void PathRasterizer::addPolygon(const float* points, int pointCount) {
+    if (pointCount < 2) return;
+    for (int i = 0; i < pointCount; i++) {
+        int next = (i + 1) % pointCount;
+        addLine(points[i * 2], points[i * 2 + 1], points[next * 2], points[next * 2 + 1]);
+    }
+}
+
+void PathRasterizer::addPath(const CanvasPath& path) {
+    // Filling treats every contour as closed
+    const std::vector<CanvasPath::Point>& points = path.getPoints();
+    int start = 0;
+    for (int end : path.getContourEnds()) {
+        for (int i = start; i < end; i++) {
+            int next = (i + 1 < end) ? i + 1 : start;
+            addLine(points[i].x, points[i].y, points[next].x, points[next].y);
+        }
+        start = end;
+    }
+}
+
+void PathRasterizer::addCircle(float centerX, float centerY, float radius, bool reversed) {
+    if (radius <= 0.0f) return;
+
+    // Enough segments to keep each chord within a tenth of a pixel of the circle
+    const float PI = 3.14159265358979f;
+    int segments = 8;
+    if (radius > 0.1f) {
+        segments = std::max(segments, (int)std::ceil(PI / std::acos(1.0f - 0.1f / radius)));
+    }
+    segments = std::min(segments, 2048);
+
+    float step = (reversed ? -2.0f : 2.0f) * PI / segments;
+    float prevX = centerX + radius;
+    float prevY = centerY;
+    for (int i = 1; i <= segments; i++) {
+        float x = (i == segments) ? centerX + radius : centerX + radius * std::cos(step * i);
+        float y = (i == segments) ? centerY : centerY + radius * std::sin(step * i);
+        addLine(prevX, prevY, x, y);
+        prevX = x;
+        prevY = y;
+    }
+}
+
+void PathRasterizer::addStroke(const CanvasPath::Point* points, int pointCount, bool closed, float thickness) {
+    if (pointCount < 1 || thickness <= 0.0f) return;
+    float halfWidth = thickness * 0.5f;
+
+    // Each segment is a quad and each joint a disc, all wound the same way so overlaps
+    // add up instead of cancelling
+    int segmentCount = closed ? pointCount : pointCount - 1;
+    for (int i = 0; i < segmentCount; i++) {
+        const CanvasPath::Point& a = points[i];
+        const CanvasPath::Point& b = points[(i + 1) % pointCount];
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length <= 0.0f) continue;
+        float nx = -dy / length * halfWidth;
+        float ny = dx / length * halfWidth;
+        float quad[8] = {
+            a.x - nx, a.y - ny,
+            b.x - nx, b.y - ny,
+            b.x + nx, b.y + ny,
+            a.x + nx, a.y + ny
+        };
+        addPolygon(quad, 4);
+    }
+
+    int firstJoint = closed ? 0 : 1;
+    int lastJoint = closed ? pointCount - 1 : pointCount - 2;
+    for (int i = firstJoint; i <= lastJoint; i++) {
+        addCircle(points[i].x, points[i].y, halfWidth);
+    }
+    if (pointCount == 1) {
+        addCircle(points[0].x, points[0].y, halfWidth);
+    }
+}
+
+void PathRasterizer::render(uint32_t* pixels, int stride, uint32_t color) {
+    if (cells.empty()) return;
+
+    std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+
+    uint32_t source = premultiplyPixel(color);
+    bool opaque = (color >> 24) == 255;
+
+    auto toCoverage = [](float value) {
+        value = std::fabs(value);
+        return value >= 1.0f ? 255u : (uint32_t)(value * 255.0f + 0.5f);
+    };
+
+    size_t i = 0;
+    while (i < cells.size()) {
+        int row = cells[i].y;
+        uint32_t* line = pixels + row * stride;
+        float accumulated = 0.0f;
+
+        while (i < cells.size() && cells[i].y == row) {
+            int x = cells[i].x;
+            float cover = 0.0f;
+            float area = 0.0f;
+            while (i < cells.size() && cells[i].y == row && cells[i].x == x) {
+                cover += cells[i].cover;
+                area += cells[i].area;
+                i++;
+            }
+
+            // The edge pixel itself, then the run up to the next cell at the running cover
+            if (x >= clipLeft && x <= clipRight) {
+                uint32_t coverage = toCoverage(accumulated + cover - area);
+                if (coverage > 0) {
+                    line[x] = blendPremultiplied(scalePixel(source, coverage), line[x]);
+                }
+            }
+            accumulated += cover;
+
+            int spanStart = std::max(x + 1, clipLeft);
+            int spanEnd = (i < cells.size() && cells[i].y == row) ? cells[i].x : clipRight + 1;
+            spanEnd = std::min(spanEnd, clipRight + 1);
+            if (spanStart >= spanEnd) continue;
+
+            uint32_t coverage = toCoverage(accumulated);
+            if (coverage == 0) continue;
+            if (coverage == 255 && opaque) {
+                std::fill(line + spanStart, line + spanEnd, source);
+                continue;
+            }
+            uint32_t spanSource = scalePixel(source, coverage);
+            uint32_t inverse = 255 - (spanSource >> 24);
+            for (int px = spanStart; px < spanEnd; px++) {
+                line[px] = spanSource + scalePixel(line[px], inverse);
+            }
+        }
+    }
+    cells.clear();
+}
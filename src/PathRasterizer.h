@@ -0,0 +1,75 @@
+#ifndef PATHRASTERIZER_H
+#define PATHRASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+
+// Outline made of straight segments and Bezier curves. Curves are flattened into line
+// segments as they are added, within a quarter of a pixel of the true curve.
+class CanvasPath {
+public:
+    struct Point {
+        float x, y;
+    };
+
+    void moveTo(float x, float y);
+    void lineTo(float x, float y);
+    void quadTo(float controlX, float controlY, float x, float y);
+    void cubicTo(float control1X, float control1Y, float control2X, float control2Y, float x, float y);
+    void close();
+    void clear();
+
+    const std::vector<Point>& getPoints() const { return points; }
+    // Index one past the last point of each contour
+    const std::vector<int>& getContourEnds() const { return contourEnds; }
+    const std::vector<bool>& getContourClosed() const { return contourClosed; }
+
+private:
+    std::vector<Point> points;
+    std::vector<int> contourEnds;
+    std::vector<bool> contourClosed;
+
+    void beginContourIfNeeded();
+};
+
+// Anti-aliased scanline rasterizer. Edges are walked into a sparse list of cells holding
+// the signed area and cover they contribute; render() sorts the cells by scanline and
+// turns the running cover sum into coverage, so the interior of a shape is filled as
+// solid spans and only pixels an edge passes through are blended individually.
+// Coordinates are in pixel space: pixel (x, y) covers [x, x + 1) x [y, y + 1).
+class PathRasterizer {
+private:
+    struct Cell {
+        int x, y;
+        float cover;
+        float area;
+    };
+
+    std::vector<Cell> cells;
+    int clipLeft, clipTop, clipRight, clipBottom;
+    float offsetX, offsetY;
+
+    void addCell(int x, int y, float cover, float area);
+    void addRowPiece(int row, float x0, float x1, float dy);
+    void addClippedLine(float x0, float y0, float x1, float y1);
+
+public:
+    PathRasterizer();
+
+    // Starts a new shape clipped to the inclusive pixel rectangle; the offset is added to
+    // every coordinate passed in afterwards
+    void reset(int left, int top, int right, int bottom, float offsetX = 0.0f, float offsetY = 0.0f);
+
+    void addLine(float x0, float y0, float x1, float y1);
+    // Closed polygon from interleaved x, y coordinates
+    void addPolygon(const float* points, int pointCount);
+    void addPath(const CanvasPath& path);
+    void addStroke(const CanvasPath::Point* points, int pointCount, bool closed, float thickness);
+    void addCircle(float centerX, float centerY, float radius, bool reversed = false);
+
+    // Composites the accumulated shape with a straight-alpha colour. Coverage is the absolute
+    // accumulated winding clamped to one, so overlapping parts wound the same way merge.
+    void render(uint32_t* pixels, int stride, uint32_t color);
+};
+
+#endif
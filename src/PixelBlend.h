@@ -0,0 +1,39 @@
+#ifndef PIXELBLEND_H
+#define PIXELBLEND_H
+
+#include <cstdint>
+
+// Internal pixel format is 0xAARRGGBB with colour channels premultiplied by alpha.
+// All helpers work on two channels at a time (R|B and A|G) and divide by 255 with
+// the exact (x + 128 + ((x + 128) >> 8)) >> 8 identity, so no division or float is needed.
+
+// Multiplies every channel of a pixel by factor/255
+inline uint32_t scalePixel(uint32_t pixel, uint32_t factor) {
+    uint32_t rb = (pixel & 0x00FF00FF) * factor + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    uint32_t ag = ((pixel >> 8) & 0x00FF00FF) * factor + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+// Converts a straight-alpha pixel to premultiplied form
+inline uint32_t premultiplyPixel(uint32_t pixel) {
+    uint32_t alpha = pixel >> 24;
+    if (alpha == 255) return pixel;
+    return (scalePixel(pixel, alpha) & 0x00FFFFFF) | (alpha << 24);
+}
+
+// Source-over compositing of a premultiplied pixel: src + dst * (255 - srcAlpha) / 255
+inline uint32_t blendPremultiplied(uint32_t src, uint32_t dst) {
+    uint32_t alpha = src >> 24;
+    if (alpha == 255) return src;
+    if (alpha == 0) return src + dst;
+    return src + scalePixel(dst, 255 - alpha);
+}
+
+// Composites a solid straight-alpha colour at the given coverage (e.g. a glyph mask)
+inline uint32_t blendCoverage(uint32_t color, uint32_t coverage, uint32_t dst) {
+    return blendPremultiplied(scalePixel(color | 0xFF000000, coverage), dst);
+}
+
+#endif
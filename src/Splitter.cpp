@@ -43,6 +43,10 @@ void Splitter::updatePanelSizes() {
         secondPanel->setPosition(0, dividerPosition + dividerWidth);
         secondPanel->setSize(width, height - dividerPosition - dividerWidth);
     }
+
+    if (resizeCallback) {
+        resizeCallback(firstPanel, secondPanel);
+    }
 }
 
 bool Splitter::isMouseOnDivider(int mouseX, int mouseY) const {
@@ -185,3 +189,7 @@ void Splitter::setDividerWidth(int width) {
     dividerWidth = width;
     updatePanelSizes();
 }
+
+void Splitter::setResizeCallback(std::function<void(Panel*, Panel*)> callback) {
+    resizeCallback = callback;
+}
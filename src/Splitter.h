@@ -3,6 +3,7 @@
 
 #include "Widget.h"
 #include "Panel.h"
+#include <functional>
 
 enum class SplitterOrientation {
     HORIZONTAL,
@@ -21,6 +22,7 @@ private:
     uint32_t dividerColor;
     uint32_t dividerHoverColor;
     bool isHoveringDivider;
+    std::function<void(Panel*, Panel*)> resizeCallback;
 
     void updatePanelSizes();
     bool isMouseOnDivider(int mouseX, int mouseY) const;
@@ -41,6 +43,8 @@ public:
     void setDividerColor(uint32_t color);
     void setDividerHoverColor(uint32_t color);
     void setDividerWidth(int width);
+    // Called whenever the panels change size, e.g. to resize a Canvas inside them
+    void setResizeCallback(std::function<void(Panel*, Panel*)> callback);
 
     Panel* getLeftPanel() const { return orientation == SplitterOrientation::HORIZONTAL ? firstPanel : nullptr; }
     Panel* getRightPanel() const { return orientation == SplitterOrientation::HORIZONTAL ? secondPanel : nullptr; }
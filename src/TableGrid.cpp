@@ -1,39 +1,141 @@
 #include "TableGrid.h"
+#include "ColumnarTableModel.h"
+#include "DelimitedText.h"
+#include "WorkerPool.h"
 #include "MiniFB.h"
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <numeric>
 #include <sstream>
 
+namespace {
+
+const size_t PARALLEL_SORT_ROWS = 1 << 16;
+const int SORT_KEY_CHUNK_ROWS = 1 << 14;
+const int EXPORT_BLOCK_ROWS = 4096;
+const size_t CLIPBOARD_FLUSH_BYTES = 1 << 20;
+
+// Same result as std::stable_sort; large inputs are sorted in chunks on the worker pool
+// and the chunks merged pairwise in order, which keeps equal keys in their original order
+template <typename Less>
+void parallelStableSort(std::vector<int>& order, Less less) {
+    WorkerPool& pool = WorkerPool::shared();
+    size_t count = order.size();
+    if (count < PARALLEL_SORT_ROWS || pool.getThreadCount() < 2) {
+        std::stable_sort(order.begin(), order.end(), less);
+        return;
+    }
+
+    int chunkCount = 1;
+    while (chunkCount < pool.getThreadCount()) {
+        chunkCount *= 2;
+    }
+    std::vector<size_t> bounds(chunkCount + 1);
+    for (int i = 0; i <= chunkCount; i++) {
+        bounds[i] = count * i / chunkCount;
+    }
+
+    std::vector<int>::iterator begin = order.begin();
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        std::stable_sort(begin + bounds[chunk], begin + bounds[chunk + 1], less);
+    });
+    for (int span = 1; span < chunkCount; span *= 2) {
+        pool.parallelFor(chunkCount / (2 * span), [&](int pair) {
+            int first = pair * 2 * span;
+            std::inplace_merge(begin + bounds[first], begin + bounds[first + span],
+                               begin + bounds[first + 2 * span], less);
+        });
+    }
+}
+
+// Reads one key per model row, in parallel, then sorts the rows that have a key.
+// Rows without one (empty or non-numeric cells) go last in either direction.
+template <typename Key, typename Read>
+void sortRowsByKey(std::vector<int>& order, int rowCount, bool ascending, Read read) {
+    std::vector<Key> keys(rowCount);
+    std::vector<char> valid(rowCount);
+    int chunkCount = (rowCount + SORT_KEY_CHUNK_ROWS - 1) / SORT_KEY_CHUNK_ROWS;
+    WorkerPool::shared().parallelFor(chunkCount, [&](int chunk) {
+        int end = std::min(rowCount, (chunk + 1) * SORT_KEY_CHUNK_ROWS);
+        for (int row = chunk * SORT_KEY_CHUNK_ROWS; row < end; row++) {
+            valid[row] = read(row, keys[row]);
+        }
+    });
+
+    std::vector<int> emptyRows;
+    order.clear();
+    order.reserve(rowCount);
+    for (int row = 0; row < rowCount; row++) {
+        if (valid[row]) {
+            order.push_back(row);
+        } else {
+            emptyRows.push_back(row);
+        }
+    }
+
+    if (ascending) {
+        parallelStableSort(order, [&keys](int a, int b) { return keys[a] < keys[b]; });
+    } else {
+        parallelStableSort(order, [&keys](int a, int b) { return keys[b] < keys[a]; });
+    }
+    order.insert(order.end(), emptyRows.begin(), emptyRows.end());
+}
+
+// Same tools as TextBox: wl-copy/wl-paste under Wayland, otherwise xclip
+FILE* openClipboard(bool forWriting) {
+    if (std::getenv("WAYLAND_DISPLAY") != nullptr) {
+        FILE* pipe = popen(forWriting ? "wl-copy" : "wl-paste -n", forWriting ? "w" : "r");
+        if (pipe) return pipe;
+    }
+    return popen(forWriting ? "xclip -selection clipboard" : "xclip -selection clipboard -o", forWriting ? "w" : "r");
+}
+
+}
+
 TableGrid::TableGrid(int x, int y, int width, int height, int rows, int cols)
-    : Widget(x, y, width, height), rows(rows), cols(cols),
-      selectedRow(-1), selectedCol(-1), hoveredRow(-1), hoveredCol(-1),
+    : TableGrid(x, y, width, height, new VectorTableModel(rows, cols)) {
+    ownsModel = true;
+}
+
+TableGrid::TableGrid(int x, int y, int width, int height, TableModel* model)
+    : Widget(x, y, width, height), model(nullptr), ownsModel(false), modelListenerId(0),
+      modelRows(model->getRowCount()), rows(model->getRowCount()), cols(model->getColCount()),
+      formulas(nullptr), sortColumn(-1), sortAscending(true), searchIndex(nullptr),
+      filterRowVisible(false), isEditingFilter(false), filterEditCol(-1),
+      selectedRow(-1), selectedCol(-1), extentRow(-1), extentCol(-1), isDragSelecting(false),
+      hoveredRow(-1), hoveredCol(-1),
       activeTextBox(nullptr), isEditing(false),
-      scrollOffsetRow(0), scrollOffsetCol(0), visibleRows(0), visibleCols(0),
+      scrollY(0), scrollX(0), scrollOffsetRow(0), scrollOffsetCol(0), visibleRows(0), visibleCols(0),
+      frozenRows(0), frozenCols(0), frozenHeight(0), frozenWidth(0),
+      cacheWidth(0), cacheHeight(0), panes(), cacheScrollX(0), cacheScrollY(0),
+      drawnSelectedRow(-1), drawnSelectedCol(-1), drawnHoveredRow(-1), drawnHoveredCol(-1), drawnEditing(false),
       rowHeight(30), headerHeight(30), headerWidth(50), defaultColumnWidth(100),
       scrollBarWidth(20),
       backgroundColor(0xFFF0F0F0), cellBackgroundColor(0xFFFFFFFF),
       headerBackgroundColor(0xFFE0E0E0), selectedBackgroundColor(MFB_RGB(0, 120, 215)),
+      rangeBackgroundColor(0xFFCCE4F7),
       hoverBackgroundColor(0xFFD0E8FF), gridLineColor(0xFFC0C0C0),
       textColor(MFB_RGB(0, 0, 0)), headerTextColor(MFB_RGB(0, 0, 0)),
       selectedTextColor(MFB_RGB(255, 255, 255)), borderColor(0xFF808080),
       cellChangeCallback(nullptr) {
 
-    // Initialize cell data
-    cells.resize(rows);
-    for (int r = 0; r < rows; r++) {
-        cells[r].resize(cols, "");
-    }
-
-    // Initialize column widths
-    columnWidths.resize(cols, defaultColumnWidth);
+    attachModel(model, false);
 
-    // Calculate actual content dimensions first
-    calculateVisibleCells();
+    // Initialize row heights and column widths
+    rowOffsets.assign(rows, rowHeight);
+    columnOffsets.assign(cols, defaultColumnWidth);
+    columnFilters.resize(cols);
 
-    // Calculate actual content area dimensions
-    int actualContentHeight = visibleRows * rowHeight;
+    // Calculate actual content area dimensions from the whole rows and columns that fit
+    int actualContentHeight = ((height - headerHeight - 2) / rowHeight) * rowHeight;  // -2 for borders
     int actualContentWidth = 0;
-    for (int c = 0; c < visibleCols; c++) {
-        actualContentWidth += getColumnWidth(c);
+    for (int c = 0; c < cols; c++) {
+        int colWidth = getColumnWidth(c);
+        if (actualContentWidth + colWidth > width - headerWidth - 2) break;
+        actualContentWidth += colWidth;
     }
 
     // Resize widget to fit actual content plus headers, borders, and scrollbars
@@ -44,26 +146,28 @@ TableGrid::TableGrid(int x, int y, int width, int height, int rows, int cols)
     // Create scrollbars positioned at the edge of actual content (accounting for borders)
     verticalScrollBar = new ScrollBar(1 + headerWidth + actualContentWidth, 1 + headerHeight, actualContentHeight, ScrollBarOrientation::VERTICAL);
     verticalScrollBar->setParent(this);
-    verticalScrollBar->setRange(0, rows);
-    verticalScrollBar->setVisibleAmount(1);
+    verticalScrollBar->setRange(0, (double)rowOffsets.total());
+    verticalScrollBar->setVisibleAmount(actualContentHeight);
     verticalScrollBar->setValue(0);
     verticalScrollBar->setChangeCallback([this](double value) {
         if (isEditing) {
             commitCellEdit();
         }
-        scrollOffsetRow = (int)value;
+        scrollY = (int64_t)value;
+        calculateVisibleCells();
     });
 
     horizontalScrollBar = new ScrollBar(1 + headerWidth, 1 + headerHeight + actualContentHeight, actualContentWidth, ScrollBarOrientation::HORIZONTAL);
     horizontalScrollBar->setParent(this);
-    horizontalScrollBar->setRange(0, cols);
-    horizontalScrollBar->setVisibleAmount(1);
+    horizontalScrollBar->setRange(0, (double)columnOffsets.total());
+    horizontalScrollBar->setVisibleAmount(actualContentWidth);
     horizontalScrollBar->setValue(0);
     horizontalScrollBar->setChangeCallback([this](double value) {
         if (isEditing) {
             commitCellEdit();
         }
-        scrollOffsetCol = (int)value;
+        scrollX = (int64_t)value;
+        calculateVisibleCells();
     });
 
     // Create TextBox for editing (initially hidden)
@@ -74,70 +178,533 @@ TableGrid::TableGrid(int x, int y, int width, int height, int rows, int cols)
 }
 
 TableGrid::~TableGrid() {
+    delete formulas;
+    delete searchIndex;
+    detachModel();
     delete verticalScrollBar;
     delete horizontalScrollBar;
     delete activeTextBox;
 }
 
-void TableGrid::calculateVisibleCells() {
-    int contentHeight = height - headerHeight - 2;  // -2 for borders
-    int contentWidth = width - headerWidth - 2;  // -2 for borders
+void TableGrid::attachModel(TableModel* newModel, bool takeOwnership) {
+    model = newModel;
+    ownsModel = takeOwnership;
+    modelListenerId = model->addChangeListener([this](const TableChange& change) {
+        handleModelChange(change);
+    });
+}
 
-    visibleRows = contentHeight / rowHeight;
+void TableGrid::detachModel() {
+    if (!model) return;
+    model->removeChangeListener(modelListenerId);
+    if (ownsModel) {
+        delete model;
+    }
+    model = nullptr;
+    ownsModel = false;
+}
 
-    visibleCols = 0;
-    int currentWidth = 0;
-    for (int c = scrollOffsetCol; c < cols; c++) {
-        int colWidth = getColumnWidth(c);
-        if (currentWidth + colWidth > contentWidth) break;
-        currentWidth += colWidth;
-        visibleCols++;
+void TableGrid::handleModelChange(const TableChange& change) {
+    // Cell changes only repaint their visible part of the cell area on the next frame
+    if (change.type != TableChange::STRUCTURE) {
+        if (searchIndex) {
+            searchIndex->updateCells(change.firstRow, change.firstCol, change.lastRow, change.lastCol);
+        }
+        if (formulas) {
+            formulas->cellsChanged(change.firstRow, change.firstCol, change.lastRow, change.lastCol);
+        }
+        invalidateModelCells(change.firstRow, change.firstCol, change.lastRow, change.lastCol);
+        return;
     }
+
+    if (isEditing) {
+        isEditing = false;
+        isEditingFilter = false;
+        activeTextBox->setFocus(false);
+    }
+    modelRows = model->getRowCount();
+    cols = model->getColCount();
+    columnOffsets.resize(cols, defaultColumnWidth);
+    columnFilters.resize(cols);
+    if (!rowHeights.empty()) {
+        rowHeights.resize(modelRows, 0);
+    }
+    if (selectedCol >= cols) {
+        selectCell(-1, -1);
+    }
+    if (searchIndex) {
+        searchIndex->clear();
+    }
+    if (formulas) {
+        formulas->structureChanged();
+    }
+    updateRowOrder(true);
 }
 
-void TableGrid::updateScrollBars() {
-    calculateVisibleCells();
+void TableGrid::updateRowOrder(bool resort) {
+    // Keep the same model row selected when the view reorders or filters
+    int selectedModelRow = (selectedRow >= 0 && selectedRow < rows) ? toModelRow(selectedRow) : -1;
+    if (resort) {
+        sortRows();
+    }
+    applyFilters();
+    // Ranges are in view rows and do not survive a reorder; the active cell does
+    int newSelectedRow = selectedModelRow >= 0 ? toViewRow(selectedModelRow) : -1;
+    selectCell(newSelectedRow, newSelectedRow >= 0 ? selectedCol : -1);
+
+    rebuildRowOffsets();
+    updateScrollBars();
+}
+
+void TableGrid::rebuildRowOffsets() {
+    if (rowHeights.empty()) {
+        rowOffsets.assign(rows, rowHeight);
+        return;
+    }
+
+    std::vector<int> heights(rows);
+    for (int viewRow = 0; viewRow < rows; viewRow++) {
+        int rowPixels = rowHeights[toModelRow(viewRow)];
+        heights[viewRow] = rowPixels > 0 ? rowPixels : rowHeight;
+    }
+    rowOffsets.assign(heights);
+}
+
+void TableGrid::applyFilters() {
+    bool filtering = false;
+    for (const std::string& filter : columnFilters) {
+        filtering = filtering || !filter.empty();
+    }
+    if (!filtering) {
+        rowOrder = sortedOrder;
+        rows = modelRows;
+        buildViewRowIndex();
+        return;
+    }
+
+    // AND the per-column match bitmaps, then keep the sorted rows that survive
+    if (!searchIndex) {
+        searchIndex = new TableIndex(model);
+    }
+    std::vector<uint64_t> keep((modelRows + 63) / 64, ~(uint64_t)0);
+    std::vector<uint64_t> matches;
+    for (int col = 0; col < cols; col++) {
+        if (columnFilters[col].empty()) continue;
+        searchIndex->findRows(col, columnFilters[col], matches);
+        for (size_t i = 0; i < keep.size(); i++) {
+            keep[i] &= matches[i];
+        }
+    }
+
+    rowOrder.clear();
+    for (int i = 0; i < modelRows; i++) {
+        int row = sortedOrder.empty() ? i : sortedOrder[i];
+        if ((keep[row >> 6] >> (row & 63)) & 1) {
+            rowOrder.push_back(row);
+        }
+    }
+    rows = (int)rowOrder.size();
+    buildViewRowIndex();
+}
+
+void TableGrid::buildViewRowIndex() {
+    viewRowOf.clear();
+    if (rowOrder.empty()) return;
+
+    viewRowOf.assign(modelRows, -1);
+    for (int viewRow = 0; viewRow < rows; viewRow++) {
+        viewRowOf[rowOrder[viewRow]] = viewRow;
+    }
+}
+
+void TableGrid::sortRows() {
+    sortedOrder.clear();
+    if (sortColumn >= cols) {
+        sortColumn = -1;
+    }
+    if (sortColumn < 0) return;
+
+    // Keys are read from worker threads, so the model must allow concurrent const reads
+    int col = sortColumn;
+    const TableModel* source = model;
+    ColumnType type = model->getColumnType(col);
+    const ColumnarTableModel* columnar = dynamic_cast<const ColumnarTableModel*>(model);
+
+    if (type == ColumnType::INT64) {
+        sortRowsByKey<int64_t>(sortedOrder, modelRows, sortAscending, [source, col](int row, int64_t& key) {
+            return source->getIntValue(row, col, key);
+        });
+    } else if (type == ColumnType::DOUBLE) {
+        sortRowsByKey<double>(sortedOrder, modelRows, sortAscending, [source, col](int row, double& key) {
+            return source->getDoubleValue(row, col, key);
+        });
+    } else if (columnar) {
+        // Rank the dictionary once and sort on the ranks instead of the strings
+        const std::vector<std::string>& dictionary = columnar->getDictionary(col);
+        std::vector<uint32_t> byText(dictionary.size());
+        std::iota(byText.begin(), byText.end(), 0);
+        std::sort(byText.begin(), byText.end(), [&dictionary](uint32_t a, uint32_t b) {
+            return dictionary[a] < dictionary[b];
+        });
+        std::vector<uint32_t> rank(dictionary.size());
+        for (size_t i = 0; i < byText.size(); i++) {
+            rank[byText[i]] = (uint32_t)i;
+        }
+        sortRowsByKey<uint32_t>(sortedOrder, modelRows, sortAscending, [columnar, col, &rank](int row, uint32_t& key) {
+            if (columnar->isNull(row, col)) return false;
+            key = rank[columnar->getStringCode(row, col)];
+            return true;
+        });
+    } else {
+        sortRowsByKey<std::string>(sortedOrder, modelRows, sortAscending, [source, col](int row, std::string& key) {
+            key = source->getCellValue(row, col);
+            return !key.empty();
+        });
+    }
+}
+
+int TableGrid::toViewRow(int modelRow) const {
+    if (modelRow < 0 || modelRow >= modelRows) return -1;
+    if (rowOrder.empty()) return rows == modelRows ? modelRow : -1;
+    return viewRowOf[modelRow];
+}
+
+void TableGrid::sortByColumn(int col, bool ascending) {
+    if (col < 0 || col >= cols) return;
+    if (isEditing) {
+        commitCellEdit();
+    }
+
+    sortColumn = col;
+    sortAscending = ascending;
+    updateRowOrder(true);
+}
+
+void TableGrid::clearSort() {
+    if (sortColumn < 0) return;
+    if (isEditing) {
+        commitCellEdit();
+    }
+
+    sortColumn = -1;
+    updateRowOrder(true);
+}
+
+void TableGrid::setColumnFilter(int col, const std::string& text) {
+    if (col < 0 || col >= cols || columnFilters[col] == text) return;
+    if (isEditing && !isEditingFilter) {
+        commitCellEdit();
+    }
+
+    columnFilters[col] = text;
+    updateRowOrder(false);
+}
+
+std::string TableGrid::getColumnFilter(int col) const {
+    if (col < 0 || col >= cols) return "";
+    return columnFilters[col];
+}
+
+void TableGrid::clearFilters() {
+    if (isEditing) {
+        commitCellEdit();
+    }
+    for (std::string& filter : columnFilters) {
+        filter.clear();
+    }
+    updateRowOrder(false);
+}
+
+void TableGrid::setFilterRowVisible(bool visible) {
+    if (visible == filterRowVisible) return;
+    if (isEditing) {
+        commitCellEdit();
+    }
+
+    // The filter row takes one row of height from the top of the cell area
+    filterRowVisible = visible;
+    updateScrollBars();
+}
+
+bool TableGrid::findNext(const std::string& text, bool forward) {
+    if (text.empty() || rows == 0 || cols == 0) return false;
+    if (isEditing) {
+        commitCellEdit();
+    }
 
-    if (rows > visibleRows) {
-        verticalScrollBar->setRange(0, rows);
-        verticalScrollBar->setVisibleAmount(visibleRows);
+    if (!searchIndex) {
+        searchIndex = new TableIndex(model);
+    }
+    std::vector<std::vector<uint64_t>> matches(cols);
+    for (int col = 0; col < cols; col++) {
+        searchIndex->findRows(col, text, matches[col]);
+    }
+
+    // Walk cells in view order starting just past the selection
+    long long total = (long long)rows * cols;
+    long long start;
+    if (selectedRow >= 0 && selectedRow < rows && selectedCol >= 0) {
+        start = (long long)selectedRow * cols + selectedCol;
+    } else {
+        start = forward ? -1 : total;
+    }
+    int step = forward ? 1 : -1;
+    for (long long i = 1; i <= total; i++) {
+        long long pos = ((start + step * i) % total + total) % total;
+        int viewRow = (int)(pos / cols);
+        int col = (int)(pos % cols);
+        int row = toModelRow(viewRow);
+        if ((matches[col][row >> 6] >> (row & 63)) & 1) {
+            selectCell(viewRow, col);
+            ensureCellVisible(viewRow, col);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Frozen cells are always on screen; scrolled ones must clear the frozen panes
+void TableGrid::ensureCellVisible(int row, int col) {
+    if (row >= frozenRows && row < rows) {
+        int64_t top = rowOffsets.prefixSum(row);
+        int64_t bottom = top + rowOffsets.get(row);
+        if (top < scrollY + frozenHeight) {
+            scrollY = top - frozenHeight;
+        } else if (bottom > scrollY + getViewportHeight()) {
+            scrollY = bottom - getViewportHeight();
+        }
+    }
+
+    if (col >= frozenCols && col < cols) {
+        int64_t left = columnOffsets.prefixSum(col);
+        int64_t right = left + columnOffsets.get(col);
+        if (left < scrollX + frozenWidth) {
+            scrollX = left - frozenWidth;
+        } else if (right > scrollX + getViewportWidth()) {
+            scrollX = right - getViewportWidth();
+        }
+    }
+    updateScrollPosition();
+}
+
+void TableGrid::setScrollPosition(int64_t x, int64_t y) {
+    if (isEditing) {
+        commitCellEdit();
+    }
+    scrollX = x;
+    scrollY = y;
+    updateScrollPosition();
+}
+
+void TableGrid::setFrozenRows(int count) {
+    count = std::max(count, 0);
+    if (count == frozenRows) return;
+    if (isEditing) {
+        commitCellEdit();
+    }
+    frozenRows = count;
+    updateScrollBars();
+}
+
+void TableGrid::setFrozenCols(int count) {
+    count = std::max(count, 0);
+    if (count == frozenCols) return;
+    if (isEditing) {
+        commitCellEdit();
+    }
+    frozenCols = count;
+    updateScrollBars();
+}
+
+int TableGrid::getModelRow(int viewRow) const {
+    if (viewRow < 0 || viewRow >= rows) return -1;
+    return toModelRow(viewRow);
+}
+
+void TableGrid::setModel(TableModel* newModel) {
+    if (!newModel || newModel == model) return;
+
+    delete formulas;
+    formulas = nullptr;
+    delete searchIndex;
+    searchIndex = nullptr;
+    detachModel();
+    attachModel(newModel, false);
+    handleModelChange({TableChange::STRUCTURE, 0, 0, newModel->getRowCount() - 1, newModel->getColCount() - 1});
+}
+
+bool TableGrid::importDelimited(const std::string& filepath, char delimiter, bool firstRowIsHeader) {
+    ColumnarTableModel* loaded = new ColumnarTableModel();
+    if (!loaded->loadDelimited(filepath.c_str(), delimiter, firstRowIsHeader)) {
+        delete loaded;
+        return false;
+    }
+
+    if (isEditing) {
+        commitCellEdit();
+    }
+    sortColumn = -1;
+    columnFilters.clear();
+    delete formulas;
+    formulas = nullptr;
+    delete searchIndex;
+    searchIndex = nullptr;
+    detachModel();
+    attachModel(loaded, true);
+    handleModelChange({TableChange::STRUCTURE, 0, 0, loaded->getRowCount() - 1, loaded->getColCount() - 1});
+    return true;
+}
+
+bool TableGrid::exportDelimited(const std::string& filepath, char delimiter, bool writeHeader) {
+    FILE* file = std::fopen(filepath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to open " << filepath << " for writing" << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    std::string line;
+    if (writeHeader && cols > 0) {
+        for (int col = 0; col < cols; col++) {
+            if (col > 0) line += delimiter;
+            DelimitedText::appendField(line, getColumnLabel(col), delimiter);
+        }
+        line += '\n';
+        ok = std::fwrite(line.data(), 1, line.size(), file) == line.size();
+    }
+
+    // Each round formats one block of view rows per worker, then writes them in order
+    WorkerPool& pool = WorkerPool::shared();
+    int blockCount = (rows + EXPORT_BLOCK_ROWS - 1) / EXPORT_BLOCK_ROWS;
+    int roundBlocks = std::max(pool.getThreadCount(), 1) * 2;
+    std::vector<std::string> blocks(std::min(roundBlocks, blockCount));
+    for (int firstBlock = 0; ok && firstBlock < blockCount; firstBlock += roundBlocks) {
+        int count = std::min(roundBlocks, blockCount - firstBlock);
+        pool.parallelFor(count, [&](int index) {
+            std::string& out = blocks[index];
+            out.clear();
+            int firstRow = (firstBlock + index) * EXPORT_BLOCK_ROWS;
+            int lastRow = std::min(firstRow + EXPORT_BLOCK_ROWS, rows);
+            if (rowOrder.empty()) {
+                model->appendCellRange(firstRow, 0, lastRow - firstRow, cols, delimiter, out);
+                return;
+            }
+            for (int row = firstRow; row < lastRow; row++) {
+                model->appendCellRange(getModelRow(row), 0, 1, cols, delimiter, out);
+            }
+        });
+        for (int index = 0; ok && index < count; index++) {
+            ok = std::fwrite(blocks[index].data(), 1, blocks[index].size(), file) == blocks[index].size();
+        }
+    }
+
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Failed to write " << filepath << std::endl;
+    }
+    return ok;
+}
+
+void TableGrid::calculateVisibleCells() {
+    layoutPanes();
+
+    // Scrolled rows and columns at least partly inside the viewport, past the frozen ones
+    int viewportHeight = std::max(getViewportHeight(), 1);
+    int viewportWidth = std::max(getViewportWidth(), 1);
+
+    if (rows > 0) {
+        scrollOffsetRow = rowOffsets.findIndex(scrollY + frozenHeight);
+        visibleRows = std::max(rowOffsets.findIndex(scrollY + viewportHeight - 1) - scrollOffsetRow + 1, 0);
     } else {
         scrollOffsetRow = 0;
-        verticalScrollBar->setValue(0);
+        visibleRows = 0;
     }
 
-    if (cols > visibleCols) {
-        horizontalScrollBar->setRange(0, cols);
-        horizontalScrollBar->setVisibleAmount(visibleCols);
+    if (cols > 0) {
+        scrollOffsetCol = columnOffsets.findIndex(scrollX + frozenWidth);
+        visibleCols = std::max(columnOffsets.findIndex(scrollX + viewportWidth - 1) - scrollOffsetCol + 1, 0);
     } else {
         scrollOffsetCol = 0;
-        horizontalScrollBar->setValue(0);
+        visibleCols = 0;
+    }
+    scrollCellCache();
+}
+
+void TableGrid::layoutScrollBars() {
+    int viewportWidth = getViewportWidth();
+    int viewportHeight = getViewportHeight();
+    int cellAreaTop = getCellAreaTop();
+
+    verticalScrollBar->setPosition(1 + headerWidth + viewportWidth, 1 + cellAreaTop);
+    verticalScrollBar->setSize(scrollBarWidth, viewportHeight);
+    horizontalScrollBar->setPosition(1 + headerWidth, 1 + cellAreaTop + viewportHeight);
+    horizontalScrollBar->setSize(viewportWidth, scrollBarWidth);
+}
+
+// After a change of layout; the cell area is repainted whole
+void TableGrid::updateScrollBars() {
+    int viewportHeight = getViewportHeight();
+    int64_t contentHeight = rowOffsets.total();
+    if (contentHeight > viewportHeight) {
+        verticalScrollBar->setRange(0, (double)contentHeight);
+        verticalScrollBar->setVisibleAmount(viewportHeight);
+    }
+
+    int viewportWidth = getViewportWidth();
+    int64_t contentWidth = columnOffsets.total();
+    if (contentWidth > viewportWidth) {
+        horizontalScrollBar->setRange(0, (double)contentWidth);
+        horizontalScrollBar->setVisibleAmount(viewportWidth);
     }
+
+    invalidateCells();
+    updateScrollPosition();
+}
+
+// After scrolling; the cache keeps what is still on screen
+void TableGrid::updateScrollPosition() {
+    layoutScrollBars();
+
+    int64_t contentHeight = rowOffsets.total();
+    scrollY = std::max<int64_t>(0, std::min<int64_t>(scrollY, contentHeight - getViewportHeight()));
+    verticalScrollBar->setValue((double)scrollY);
+
+    int64_t contentWidth = columnOffsets.total();
+    scrollX = std::max<int64_t>(0, std::min<int64_t>(scrollX, contentWidth - getViewportWidth()));
+    horizontalScrollBar->setValue((double)scrollX);
+
+    calculateVisibleCells();
 }
 
 int TableGrid::getCellX(int col) {
     int absX = getAbsoluteX();
-    int x = absX + 1 + headerWidth;  // +1 for left border
-    for (int c = scrollOffsetCol; c < col && c < cols; c++) {
-        x += getColumnWidth(c);
-    }
-    return x;
+    int64_t offset = col < frozenCols ? 0 : scrollX;
+    return absX + 1 + headerWidth + (int)(columnOffsets.prefixSum(col) - offset);  // +1 for left border
 }
 
 int TableGrid::getCellY(int row) {
     int absY = getAbsoluteY();
-    return absY + 1 + headerHeight + (row - scrollOffsetRow) * rowHeight;  // +1 for top border
+    int64_t offset = row < frozenRows ? 0 : scrollY;
+    return absY + 1 + getCellAreaTop() + (int)(rowOffsets.prefixSum(row) - offset);  // +1 for top border
 }
 
-int TableGrid::getColumnWidth(int col) {
-    if (col >= 0 && col < (int)columnWidths.size()) {
-        return columnWidths[col];
+int TableGrid::getColumnWidth(int col) const {
+    if (col >= 0 && col < columnOffsets.size()) {
+        return columnOffsets.get(col);
     }
     return defaultColumnWidth;
 }
 
+int TableGrid::getRowHeight(int row) const {
+    if (row >= 0 && row < (int)rowHeights.size() && rowHeights[row] > 0) {
+        return rowHeights[row];
+    }
+    return rowHeight;
+}
+
 std::string TableGrid::getColumnLabel(int col) {
-    std::string label;
+    std::string label = model->getColumnName(col);
+    if (!label.empty()) return label;
     do {
         label = char('A' + (col % 26)) + label;
         col = col / 26 - 1;
@@ -150,10 +717,17 @@ void TableGrid::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
     int absY = getAbsoluteY();
     int endX = std::min(absX + width, bufferWidth);
     int endY = std::min(absY + height, bufferHeight);
+    int areaLeft, areaTop, areaRight, areaBottom;
+    getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
 
-    // Draw background
+    // Draw background around the cell area, which comes from the cache
     for (int py = absY; py < endY; py++) {
+        bool besideArea = py >= areaTop && py < areaBottom && areaLeft < areaRight;
         for (int px = absX; px < endX; px++) {
+            if (besideArea && px == areaLeft) {
+                px = areaRight - 1;
+                continue;
+            }
             if (px >= 0 && py >= 0) {
                 buffer[py * bufferWidth + px] = backgroundColor;
             }
@@ -161,40 +735,59 @@ void TableGrid::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
     }
 
     // Draw border
-    for (int py = absY; py < endY; py++) {
-        for (int px = absX; px < endX; px++) {
-            if (px >= 0 && py >= 0) {
-                if (py == absY || py == endY - 1 || px == absX || px == endX - 1) {
-                    buffer[py * bufferWidth + px] = borderColor;
-                }
+    for (int py = std::max(absY, 0); py < endY; py++) {
+        if (py == absY || py == endY - 1) {
+            for (int px = std::max(absX, 0); px < endX; px++) {
+                buffer[py * bufferWidth + px] = borderColor;
             }
+            continue;
+        }
+        if (absX >= 0) {
+            buffer[py * bufferWidth + absX] = borderColor;
+        }
+        if (endX - 1 >= 0) {
+            buffer[py * bufferWidth + endX - 1] = borderColor;
         }
     }
 
-    // Draw row headers
+    // Draw row headers, scrolled ones first so the frozen ones cover any overlap
     for (int r = scrollOffsetRow; r < rows && r < scrollOffsetRow + visibleRows; r++) {
         int headerY = getCellY(r);
-        drawRowHeader(buffer, bufferWidth, bufferHeight, r, headerY);
+        drawRowHeader(buffer, bufferWidth, bufferHeight, r, headerY, rowOffsets.get(r));
+    }
+    for (int r = 0; r < frozenRows && r < rows; r++) {
+        drawRowHeader(buffer, bufferWidth, bufferHeight, r, getCellY(r), rowOffsets.get(r));
     }
 
-    // Draw column headers
-    int colX = absX + 1 + headerWidth;  // +1 for left border
+    // Draw column headers the same way
+    int colX = getCellX(scrollOffsetCol);
     for (int c = scrollOffsetCol; c < cols && c < scrollOffsetCol + visibleCols; c++) {
         int colWidth = getColumnWidth(c);
         drawColumnHeader(buffer, bufferWidth, bufferHeight, c, colX, colWidth);
+        if (filterRowVisible) {
+            drawFilterCell(buffer, bufferWidth, bufferHeight, c, colX, colWidth);
+        }
         colX += colWidth;
     }
-
-    // Draw cells
-    for (int r = scrollOffsetRow; r < rows && r < scrollOffsetRow + visibleRows; r++) {
-        int cellY = getCellY(r);
-        int cellX = absX + 1 + headerWidth;  // +1 for left border
-
-        for (int c = scrollOffsetCol; c < cols && c < scrollOffsetCol + visibleCols; c++) {
-            int colWidth = getColumnWidth(c);
-            drawCell(buffer, bufferWidth, bufferHeight, r, c, cellX, cellY, colWidth, rowHeight);
-            cellX += colWidth;
+    colX = getCellX(0);
+    for (int c = 0; c < frozenCols && c < cols; c++) {
+        int colWidth = getColumnWidth(c);
+        drawColumnHeader(buffer, bufferWidth, bufferHeight, c, colX, colWidth);
+        if (filterRowVisible) {
+            drawFilterCell(buffer, bufferWidth, bufferHeight, c, colX, colWidth);
         }
+        colX += colWidth;
+    }
+
+    // Draw cells from the cache, repainting what changed since the last frame
+    renderCellCache();
+    int copyLeft = std::max(areaLeft, 0);
+    int copyRight = std::min(areaRight, bufferWidth);
+    int copyTop = std::max(areaTop, 0);
+    int copyBottom = std::min(areaBottom, bufferHeight);
+    for (int py = copyTop; py < copyBottom && copyLeft < copyRight; py++) {
+        const uint32_t* source = cellCache.data() + (size_t)(py - areaTop) * cacheWidth + (copyLeft - areaLeft);
+        std::copy(source, source + (copyRight - copyLeft), buffer + (size_t)py * bufferWidth + copyLeft);
     }
 
     // Draw active TextBox if editing
@@ -203,86 +796,357 @@ void TableGrid::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
     }
 
     // Draw scrollbars
-    if (rows > visibleRows) {
+    if (hasVerticalScroll()) {
         verticalScrollBar->draw(buffer, bufferWidth, bufferHeight);
     }
-    if (cols > visibleCols) {
+    if (hasHorizontalScroll()) {
         horizontalScrollBar->draw(buffer, bufferWidth, bufferHeight);
     }
 }
 
-void TableGrid::drawCell(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int col, int cellX, int cellY, int cellWidth, int cellHeight) {
-    int endX = std::min(cellX + cellWidth, bufferWidth);
-    int endY = std::min(cellY + cellHeight, bufferHeight);
+void TableGrid::getCellAreaRect(int& left, int& top, int& right, int& bottom) {
+    left = getAbsoluteX() + 1 + headerWidth;  // +1 for left border
+    top = getAbsoluteY() + 1 + getCellAreaTop();  // +1 for top border
+    right = left + getViewportWidth();
+    bottom = top + getViewportHeight();
+}
+
+// Splits the viewport at the frozen rows and columns into the corner, frozen rows, frozen
+// columns and body panes; when the split moves every pane is repainted
+void TableGrid::layoutPanes() {
+    int viewportWidth = getViewportWidth();
+    int viewportHeight = getViewportHeight();
+    frozenWidth = (int)std::min<int64_t>(columnOffsets.prefixSum(std::min(frozenCols, columnOffsets.size())), viewportWidth);
+    frozenHeight = (int)std::min<int64_t>(rowOffsets.prefixSum(std::min(frozenRows, rowOffsets.size())), viewportHeight);
+
+    const int splitX[3] = {0, frozenWidth, viewportWidth};
+    const int splitY[3] = {0, frozenHeight, viewportHeight};
+    bool moved = false;
+    for (int i = 0; i < 4; i++) {
+        CachePane& pane = panes[i];
+        int column = i & 1;
+        int row = i >> 1;
+        if (pane.left != splitX[column] || pane.right != splitX[column + 1] ||
+            pane.top != splitY[row] || pane.bottom != splitY[row + 1]) {
+            pane.left = splitX[column];
+            pane.right = splitX[column + 1];
+            pane.top = splitY[row];
+            pane.bottom = splitY[row + 1];
+            moved = true;
+        }
+        pane.scrollsX = column == 1;
+        pane.scrollsY = row == 1;
+    }
+    if (moved) {
+        invalidateCells();
+    }
+}
+
+// Brings the cached pixels to the current scroll position. Each pane that scrolls moves
+// what stays on screen and leaves only the strip scrolled in, plus any damage it carried,
+// to be redrawn.
+void TableGrid::scrollCellCache() {
+    int64_t deltaX = scrollX - cacheScrollX;
+    int64_t deltaY = scrollY - cacheScrollY;
+    if (deltaX == 0 && deltaY == 0) return;
+    cacheScrollX = scrollX;
+    cacheScrollY = scrollY;
+    if (cacheWidth != getViewportWidth() || cacheHeight != getViewportHeight()) {
+        // The cache is reallocated and repainted on the next frame anyway
+        invalidateCells();
+        return;
+    }
+
+    for (CachePane& pane : panes) {
+        int paneWidth = pane.right - pane.left;
+        int paneHeight = pane.bottom - pane.top;
+        int64_t shiftX = pane.scrollsX ? deltaX : 0;
+        int64_t shiftY = pane.scrollsY ? deltaY : 0;
+        if ((shiftX == 0 && shiftY == 0) || paneWidth <= 0 || paneHeight <= 0) continue;
+
+        bool allDirty = pane.dirty && pane.dirtyLeft <= pane.left && pane.dirtyTop <= pane.top &&
+                        pane.dirtyRight >= pane.right && pane.dirtyBottom >= pane.bottom;
+        if (allDirty || shiftX <= -paneWidth || shiftX >= paneWidth || shiftY <= -paneHeight || shiftY >= paneHeight) {
+            invalidatePaneRect(pane, pane.left, pane.top, pane.right, pane.bottom);
+            continue;
+        }
+
+        // Pixels move against the scroll. Rows are copied in the order that reads each
+        // source row before it is overwritten; memmove handles overlap within a row.
+        int moveX = (int)shiftX;
+        int moveY = (int)shiftY;
+        int copyWidth = paneWidth - std::abs(moveX);
+        int destX = pane.left + std::max(-moveX, 0);
+        int sourceX = pane.left + std::max(moveX, 0);
+        int destTop = pane.top + std::max(-moveY, 0);
+        int destBottom = pane.bottom - std::max(moveY, 0);
+        uint32_t* pixels = cellCache.data();
+        for (int i = 0; i < destBottom - destTop; i++) {
+            int py = moveY > 0 ? destTop + i : destBottom - 1 - i;
+            std::memmove(pixels + (size_t)py * cacheWidth + destX, pixels + (size_t)(py + moveY) * cacheWidth + sourceX,
+                         copyWidth * sizeof(uint32_t));
+        }
+
+        if (pane.dirty) {
+            pane.dirty = false;
+            invalidatePaneRect(pane, (int64_t)pane.dirtyLeft - moveX, (int64_t)pane.dirtyTop - moveY,
+                               (int64_t)pane.dirtyRight - moveX, (int64_t)pane.dirtyBottom - moveY);
+        }
+        if (moveX > 0) {
+            invalidatePaneRect(pane, pane.right - moveX, pane.top, pane.right, pane.bottom);
+        } else if (moveX < 0) {
+            invalidatePaneRect(pane, pane.left, pane.top, pane.left - moveX, pane.bottom);
+        }
+        if (moveY > 0) {
+            invalidatePaneRect(pane, pane.left, pane.bottom - moveY, pane.right, pane.bottom);
+        } else if (moveY < 0) {
+            invalidatePaneRect(pane, pane.left, pane.top, pane.right, pane.top - moveY);
+        }
+    }
+}
+
+void TableGrid::renderCellCache() {
+    int viewportWidth = getViewportWidth();
+    int viewportHeight = getViewportHeight();
+    if (viewportWidth != cacheWidth || viewportHeight != cacheHeight) {
+        cacheWidth = viewportWidth;
+        cacheHeight = viewportHeight;
+        cellCache.assign((size_t)cacheWidth * cacheHeight, backgroundColor);
+        layoutPanes();
+        invalidateCells();
+    }
+    scrollCellCache();
+
+    // Cells whose highlight changed since the last frame
+    bool editing = isEditing && !isEditingFilter;
+    if (selectedRow != drawnSelectedRow || selectedCol != drawnSelectedCol || editing != drawnEditing) {
+        invalidateCell(drawnSelectedRow, drawnSelectedCol);
+        invalidateCell(selectedRow, selectedCol);
+        drawnSelectedRow = selectedRow;
+        drawnSelectedCol = selectedCol;
+        drawnEditing = editing;
+    }
+    if (hoveredRow != drawnHoveredRow || hoveredCol != drawnHoveredCol) {
+        invalidateCell(drawnHoveredRow, drawnHoveredCol);
+        invalidateCell(hoveredRow, hoveredCol);
+        drawnHoveredRow = hoveredRow;
+        drawnHoveredCol = hoveredCol;
+    }
+
+    for (CachePane& pane : panes) {
+        renderPane(pane);
+    }
+}
+
+void TableGrid::renderPane(CachePane& pane) {
+    if (!pane.dirty) return;
+    pane.dirty = false;
+    int clipLeft = std::max({pane.dirtyLeft, pane.left, 0});
+    int clipTop = std::max({pane.dirtyTop, pane.top, 0});
+    int clipRight = std::min({pane.dirtyRight, pane.right, cacheWidth});
+    int clipBottom = std::min({pane.dirtyBottom, pane.bottom, cacheHeight});
+    if (clipLeft >= clipRight || clipTop >= clipBottom) return;
+
+    for (int py = clipTop; py < clipBottom; py++) {
+        uint32_t* line = cellCache.data() + (size_t)py * cacheWidth;
+        std::fill(line + clipLeft, line + clipRight, backgroundColor);
+    }
+    int64_t originX = pane.scrollsX ? cacheScrollX : 0;
+    int64_t originY = pane.scrollsY ? cacheScrollY : 0;
+    if (originY + clipTop >= rowOffsets.total() || originX + clipLeft >= columnOffsets.total()) return;
+
+    // Fetch only the cells touching the dirty rectangle
+    int firstRow = rowOffsets.findIndex(originY + clipTop);
+    int lastRow = rowOffsets.findIndex(originY + clipBottom - 1);
+    int firstCol = columnOffsets.findIndex(originX + clipLeft);
+    int lastCol = columnOffsets.findIndex(originX + clipRight - 1);
+    int drawRows = lastRow - firstRow + 1;
+    int drawCols = lastCol - firstCol + 1;
+    if (rowOrder.empty()) {
+        model->getCellRange(firstRow, firstCol, drawRows, drawCols, visibleValues);
+    } else {
+        // Sorted rows are scattered through the model, so fetch them one row at a time
+        visibleValues.resize((size_t)drawRows * drawCols);
+        for (int r = 0; r < drawRows; r++) {
+            model->getCellRange(rowOrder[firstRow + r], firstCol, 1, drawCols, rowValues);
+            std::move(rowValues.begin(), rowValues.end(), visibleValues.begin() + (size_t)r * drawCols);
+        }
+    }
+
+    int startX = (int)(columnOffsets.prefixSum(firstCol) - originX);
+    for (int r = 0; r < drawRows; r++) {
+        int row = firstRow + r;
+        int cellY = (int)(rowOffsets.prefixSum(row) - originY);
+        int cellHeight = rowOffsets.get(row);
+        int cellX = startX;
+        for (int c = 0; c < drawCols; c++) {
+            int colWidth = getColumnWidth(firstCol + c);
+            drawCell(cellCache.data(), cacheWidth, cacheHeight, row, firstCol + c, cellX, cellY, colWidth, cellHeight,
+                     visibleValues[(size_t)r * drawCols + c], clipLeft, clipTop, clipRight, clipBottom);
+            cellX += colWidth;
+        }
+    }
+}
+
+void TableGrid::invalidateCells() {
+    for (CachePane& pane : panes) {
+        pane.dirty = true;
+        pane.dirtyLeft = pane.left;
+        pane.dirtyTop = pane.top;
+        pane.dirtyRight = pane.right;
+        pane.dirtyBottom = pane.bottom;
+    }
+}
+
+// Rectangle in viewport coordinates, exclusive right/bottom; clamped to the pane before narrowing
+void TableGrid::invalidatePaneRect(CachePane& pane, int64_t left, int64_t top, int64_t right, int64_t bottom) {
+    int clampedLeft = (int)std::max<int64_t>(left, pane.left);
+    int clampedTop = (int)std::max<int64_t>(top, pane.top);
+    int clampedRight = (int)std::min<int64_t>(right, pane.right);
+    int clampedBottom = (int)std::min<int64_t>(bottom, pane.bottom);
+    if (clampedLeft >= clampedRight || clampedTop >= clampedBottom) return;
+
+    if (pane.dirty) {
+        pane.dirtyLeft = std::min(pane.dirtyLeft, clampedLeft);
+        pane.dirtyTop = std::min(pane.dirtyTop, clampedTop);
+        pane.dirtyRight = std::max(pane.dirtyRight, clampedRight);
+        pane.dirtyBottom = std::max(pane.dirtyBottom, clampedBottom);
+    } else {
+        pane.dirty = true;
+        pane.dirtyLeft = clampedLeft;
+        pane.dirtyTop = clampedTop;
+        pane.dirtyRight = clampedRight;
+        pane.dirtyBottom = clampedBottom;
+    }
+}
+
+// Rectangle in content pixels, marked in each pane it shows in at the cached scroll position
+void TableGrid::invalidateContentRect(int64_t left, int64_t top, int64_t right, int64_t bottom) {
+    for (CachePane& pane : panes) {
+        int64_t originX = pane.scrollsX ? cacheScrollX : 0;
+        int64_t originY = pane.scrollsY ? cacheScrollY : 0;
+        invalidatePaneRect(pane, left - originX, top - originY, right - originX, bottom - originY);
+    }
+}
+
+void TableGrid::invalidateCell(int row, int col) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) return;
+    int64_t left = columnOffsets.prefixSum(col);
+    int64_t top = rowOffsets.prefixSum(row);
+    invalidateContentRect(left, top, left + columnOffsets.get(col), top + rowOffsets.get(row));
+}
+
+// Maps a block of model cells onto the rows on screen: the frozen ones, then the scrolled ones
+void TableGrid::invalidateModelCells(int firstRow, int firstCol, int lastRow, int lastCol) {
+    int colEnd = std::min(lastCol, cols - 1);
+    if (firstCol > colEnd) return;
+    int64_t left = columnOffsets.prefixSum(firstCol);
+    int64_t right = columnOffsets.prefixSum(colEnd + 1);
+
+    int runs[2][2] = {{0, std::min(frozenRows, rows)},
+                      {std::max(scrollOffsetRow, frozenRows), std::min(rows, scrollOffsetRow + visibleRows)}};
+    for (const auto& run : runs) {
+        int topRow = -1;
+        int bottomRow = -1;
+        for (int r = run[0]; r < run[1]; r++) {
+            int modelRow = toModelRow(r);
+            if (modelRow >= firstRow && modelRow <= lastRow) {
+                if (topRow < 0) topRow = r;
+                bottomRow = r;
+            }
+        }
+        if (topRow >= 0) {
+            invalidateContentRect(left, rowOffsets.prefixSum(topRow), right, rowOffsets.prefixSum(bottomRow + 1));
+        }
+    }
+}
+
+void TableGrid::drawCell(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int col, int cellX, int cellY, int cellWidth, int cellHeight,
+                         const std::string& cellText, int clipLeft, int clipTop, int clipRight, int clipBottom) {
+    // Clip to the region being repainted so neighbouring cells are left alone
+    clipLeft = std::max(clipLeft, cellX);
+    clipTop = std::max(clipTop, cellY);
+    clipRight = std::min(clipRight, cellX + cellWidth);
+    clipBottom = std::min(clipBottom, cellY + cellHeight);
+    if (clipLeft >= clipRight || clipTop >= clipBottom) return;
+
+    int endX = cellX + cellWidth;
+    int endY = cellY + cellHeight;
 
     uint32_t bgColor = cellBackgroundColor;
-    if (row == selectedRow && col == selectedCol && !isEditing) {
+    bool editingThisCell = isEditing && !isEditingFilter && row == selectedRow && col == selectedCol;
+    if (row == selectedRow && col == selectedCol && !editingThisCell) {
         bgColor = selectedBackgroundColor;
+    } else if (!editingThisCell && isCellSelected(row, col)) {
+        bgColor = rangeBackgroundColor;
     } else if (row == hoveredRow && col == hoveredCol) {
         bgColor = hoverBackgroundColor;
     }
 
     // Draw cell background
-    for (int py = cellY; py < endY; py++) {
-        for (int px = cellX; px < endX; px++) {
-            if (px >= 0 && py >= 0) {
-                buffer[py * bufferWidth + px] = bgColor;
-            }
+    for (int py = clipTop; py < clipBottom; py++) {
+        for (int px = clipLeft; px < clipRight; px++) {
+            buffer[py * bufferWidth + px] = bgColor;
         }
     }
 
     // Draw grid lines
-    for (int px = cellX; px < endX; px++) {
-        if (px >= 0 && cellY >= 0 && cellY < bufferHeight) {
+    for (int px = clipLeft; px < clipRight; px++) {
+        if (cellY >= clipTop && cellY < clipBottom) {
             buffer[cellY * bufferWidth + px] = gridLineColor;
         }
-        if (px >= 0 && endY - 1 >= 0 && endY - 1 < bufferHeight) {
+        if (endY - 1 >= clipTop && endY - 1 < clipBottom) {
             buffer[(endY - 1) * bufferWidth + px] = gridLineColor;
         }
     }
-    for (int py = cellY; py < endY; py++) {
-        if (py >= 0 && cellX >= 0 && cellX < bufferWidth) {
+    for (int py = clipTop; py < clipBottom; py++) {
+        if (cellX >= clipLeft && cellX < clipRight) {
             buffer[py * bufferWidth + cellX] = gridLineColor;
         }
-        if (py >= 0 && endX - 1 >= 0 && endX - 1 < bufferWidth) {
+        if (endX - 1 >= clipLeft && endX - 1 < clipRight) {
             buffer[py * bufferWidth + (endX - 1)] = gridLineColor;
         }
     }
 
     // Draw cell text (skip if editing this cell)
-    if (fontRenderer && !(isEditing && row == selectedRow && col == selectedCol)) {
-        const std::string& cellText = cells[row][col];
+    if (fontRenderer && !editingThisCell) {
         if (!cellText.empty()) {
             uint32_t txtColor = (row == selectedRow && col == selectedCol) ? selectedTextColor : textColor;
             int textX = cellX + 5;
             int textY = cellY + (cellHeight + fontRenderer->getTextHeight()) / 2;
-            fontRenderer->drawText(buffer, bufferWidth, bufferHeight, cellText, textX, textY, txtColor);
+            fontRenderer->drawTextClipped(buffer, bufferWidth, bufferHeight, cellText, textX, textY, txtColor,
+                                          clipLeft, clipTop, clipRight, clipBottom);
         }
     }
 }
 
-void TableGrid::drawRowHeader(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int headerY) {
+void TableGrid::drawRowHeader(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int headerY, int headerRowHeight) {
+    int areaLeft, areaTop, areaRight, areaBottom;
+    getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
     int absX = getAbsoluteX();
-    int endX = std::min(absX + 1 + headerWidth, bufferWidth);  // +1 for left border
-    int endY = std::min(headerY + rowHeight, bufferHeight);
+    int clipLeft = std::max(absX + 1, 0);  // +1 to start after left border
+    int clipTop = std::max({headerY, areaTop, 0});
+    int clipRight = std::min(absX + 1 + headerWidth, bufferWidth);
+    int clipBottom = std::min({headerY + headerRowHeight, areaBottom, bufferHeight});
+    if (clipLeft >= clipRight || clipTop >= clipBottom) return;
+
+    int endX = absX + 1 + headerWidth;
 
     // Draw header background
-    for (int py = headerY; py < endY; py++) {
-        for (int px = absX + 1; px < endX; px++) {  // +1 to start after left border
-            if (px >= 0 && py >= 0) {
-                buffer[py * bufferWidth + px] = headerBackgroundColor;
-            }
+    for (int py = clipTop; py < clipBottom; py++) {
+        for (int px = clipLeft; px < clipRight; px++) {
+            buffer[py * bufferWidth + px] = headerBackgroundColor;
         }
     }
 
     // Draw grid lines
-    for (int px = absX + 1; px < endX; px++) {  // +1 to start after left border
-        if (px >= 0 && headerY >= 0 && headerY < bufferHeight) {
+    if (headerY >= clipTop && headerY < clipBottom) {
+        for (int px = clipLeft; px < clipRight; px++) {
             buffer[headerY * bufferWidth + px] = gridLineColor;
         }
     }
-    for (int py = headerY; py < endY; py++) {
-        if (py >= 0 && endX - 1 >= 0 && endX - 1 < bufferWidth) {
+    if (endX - 1 >= clipLeft && endX - 1 < clipRight) {
+        for (int py = clipTop; py < clipBottom; py++) {
             buffer[py * bufferWidth + (endX - 1)] = gridLineColor;
         }
     }
@@ -291,33 +1155,40 @@ void TableGrid::drawRowHeader(uint32_t* buffer, int bufferWidth, int bufferHeigh
     if (fontRenderer) {
         std::string rowLabel = std::to_string(row + 1);
         int textX = absX + 1 + headerWidth / 2 - (fontRenderer->getTextWidth(rowLabel) / 2);  // +1 for border
-        int textY = headerY + (rowHeight + fontRenderer->getTextHeight()) / 2;
-        fontRenderer->drawText(buffer, bufferWidth, bufferHeight, rowLabel, textX, textY, headerTextColor);
+        int textY = headerY + (headerRowHeight + fontRenderer->getTextHeight()) / 2;
+        fontRenderer->drawTextClipped(buffer, bufferWidth, bufferHeight, rowLabel, textX, textY, headerTextColor,
+                                      clipLeft, clipTop, clipRight, clipBottom);
     }
 }
 
 void TableGrid::drawColumnHeader(uint32_t* buffer, int bufferWidth, int bufferHeight, int col, int headerX, int colWidth) {
+    int areaLeft, areaTop, areaRight, areaBottom;
+    getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
     int absY = getAbsoluteY();
-    int endX = std::min(headerX + colWidth, bufferWidth);
-    int endY = std::min(absY + 1 + headerHeight, bufferHeight);  // +1 for top border
+    int clipLeft = std::max({headerX, areaLeft, 0});
+    int clipTop = std::max(absY + 1, 0);  // +1 to start after top border
+    int clipRight = std::min({headerX + colWidth, areaRight, bufferWidth});
+    int clipBottom = std::min(absY + 1 + headerHeight, bufferHeight);
+    if (clipLeft >= clipRight || clipTop >= clipBottom) return;
+
+    int endX = headerX + colWidth;
+    int endY = absY + 1 + headerHeight;
 
     // Draw header background
-    for (int py = absY + 1; py < endY; py++) {  // +1 to start after top border
-        for (int px = headerX; px < endX; px++) {
-            if (px >= 0 && py >= 0) {
-                buffer[py * bufferWidth + px] = headerBackgroundColor;
-            }
+    for (int py = clipTop; py < clipBottom; py++) {
+        for (int px = clipLeft; px < clipRight; px++) {
+            buffer[py * bufferWidth + px] = headerBackgroundColor;
         }
     }
 
     // Draw grid lines
-    for (int px = headerX; px < endX; px++) {
-        if (px >= 0 && endY - 1 >= 0 && endY - 1 < bufferHeight) {
+    if (endY - 1 >= clipTop && endY - 1 < clipBottom) {
+        for (int px = clipLeft; px < clipRight; px++) {
             buffer[(endY - 1) * bufferWidth + px] = gridLineColor;
         }
     }
-    for (int py = absY + 1; py < endY; py++) {  // +1 to start after top border
-        if (py >= 0 && endX - 1 >= 0 && endX - 1 < bufferWidth) {
+    if (endX - 1 >= clipLeft && endX - 1 < clipRight) {
+        for (int py = clipTop; py < clipBottom; py++) {
             buffer[py * bufferWidth + (endX - 1)] = gridLineColor;
         }
     }
@@ -327,7 +1198,62 @@ void TableGrid::drawColumnHeader(uint32_t* buffer, int bufferWidth, int bufferHe
         std::string colLabel = getColumnLabel(col);
         int textX = headerX + colWidth / 2 - (fontRenderer->getTextWidth(colLabel) / 2);
         int textY = absY + 1 + (headerHeight + fontRenderer->getTextHeight()) / 2;  // +1 for border
-        fontRenderer->drawText(buffer, bufferWidth, bufferHeight, colLabel, textX, textY, headerTextColor);
+        fontRenderer->drawTextClipped(buffer, bufferWidth, bufferHeight, colLabel, textX, textY, headerTextColor,
+                                      clipLeft, clipTop, clipRight, clipBottom);
+    }
+
+    // Draw sort arrow near the right edge, pointing up for ascending
+    if (col == sortColumn) {
+        int arrowX = endX - 12;
+        int arrowY = absY + 1 + headerHeight / 2 - 2;
+        for (int i = 0; i < 5; i++) {
+            int py = sortAscending ? arrowY + i : arrowY + 4 - i;
+            if (py < clipTop || py >= clipBottom) continue;
+            for (int px = std::max(arrowX - i, clipLeft); px <= arrowX + i && px < clipRight; px++) {
+                buffer[py * bufferWidth + px] = headerTextColor;
+            }
+        }
+    }
+}
+
+void TableGrid::drawFilterCell(uint32_t* buffer, int bufferWidth, int bufferHeight, int col, int cellX, int colWidth) {
+    int areaLeft, areaTop, areaRight, areaBottom;
+    getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
+    int cellY = getAbsoluteY() + 1 + headerHeight;  // +1 for top border
+    int clipLeft = std::max({cellX, areaLeft, 0});
+    int clipTop = std::max(cellY, 0);
+    int clipRight = std::min({cellX + colWidth, areaRight, bufferWidth});
+    int clipBottom = std::min(cellY + rowHeight, bufferHeight);
+    if (clipLeft >= clipRight || clipTop >= clipBottom) return;
+
+    int endX = cellX + colWidth;
+    int endY = cellY + rowHeight;
+
+    // Draw cell background
+    for (int py = clipTop; py < clipBottom; py++) {
+        for (int px = clipLeft; px < clipRight; px++) {
+            buffer[py * bufferWidth + px] = cellBackgroundColor;
+        }
+    }
+
+    // Draw grid lines
+    if (endY - 1 >= clipTop && endY - 1 < clipBottom) {
+        for (int px = clipLeft; px < clipRight; px++) {
+            buffer[(endY - 1) * bufferWidth + px] = gridLineColor;
+        }
+    }
+    if (endX - 1 >= clipLeft && endX - 1 < clipRight) {
+        for (int py = clipTop; py < clipBottom; py++) {
+            buffer[py * bufferWidth + (endX - 1)] = gridLineColor;
+        }
+    }
+
+    // Draw filter text (skip if editing this filter)
+    if (fontRenderer && !columnFilters[col].empty() && !(isEditingFilter && col == filterEditCol)) {
+        int textX = cellX + 5;
+        int textY = cellY + (rowHeight + fontRenderer->getTextHeight()) / 2;
+        fontRenderer->drawTextClipped(buffer, bufferWidth, bufferHeight, columnFilters[col], textX, textY, textColor,
+                                      clipLeft, clipTop, clipRight, clipBottom);
     }
 }
 
@@ -337,45 +1263,59 @@ void TableGrid::checkHover(int mouseX, int mouseY) {
 
     getCellAtPosition(mouseX, mouseY, hoveredRow, hoveredCol);
 
-    if (rows > visibleRows) {
+    if (hasVerticalScroll()) {
         verticalScrollBar->checkHover(mouseX, mouseY);
     }
-    if (cols > visibleCols) {
+    if (hasHorizontalScroll()) {
         horizontalScrollBar->checkHover(mouseX, mouseY);
     }
 }
 
 bool TableGrid::getCellAtPosition(int mouseX, int mouseY, int& row, int& col) {
-    int absX = getAbsoluteX();
-    int absY = getAbsoluteY();
+    int areaLeft, areaTop, areaRight, areaBottom;
+    getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
 
     // Check row
-    if (mouseY < absY + headerHeight || mouseY >= absY + height - scrollBarWidth) {
+    if (mouseY < areaTop || mouseY >= areaBottom) {
         return false;
     }
-    int relativeY = mouseY - (absY + headerHeight);
-    row = scrollOffsetRow + (relativeY / rowHeight);
-    if (row < 0 || row >= rows) {
+    // Frozen rows are not scrolled
+    int64_t offsetY = mouseY - areaTop;
+    if (offsetY >= frozenHeight) {
+        offsetY += scrollY;
+    }
+    if (offsetY >= rowOffsets.total()) {
         return false;
     }
 
     // Check column
-    if (mouseX < absX + headerWidth || mouseX >= absX + width - scrollBarWidth) {
+    int hitCol;
+    if (!getColumnAtX(mouseX, hitCol)) {
         return false;
     }
-    int relativeX = mouseX - (absX + headerWidth);
-    int currentX = 0;
-    col = -1;
-    for (int c = scrollOffsetCol; c < cols; c++) {
-        int colWidth = getColumnWidth(c);
-        if (relativeX >= currentX && relativeX < currentX + colWidth) {
-            col = c;
-            break;
-        }
-        currentX += colWidth;
+
+    row = rowOffsets.findIndex(offsetY);
+    col = hitCol;
+    return true;
+}
+
+bool TableGrid::getColumnAtX(int mouseX, int& col) {
+    int areaLeft, areaTop, areaRight, areaBottom;
+    getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
+
+    if (mouseX < areaLeft || mouseX >= areaRight) {
+        return false;
+    }
+    int64_t offsetX = mouseX - areaLeft;
+    if (offsetX >= frozenWidth) {
+        offsetX += scrollX;
+    }
+    if (offsetX >= columnOffsets.total()) {
+        return false;
     }
 
-    return (col >= 0 && col < cols);
+    col = columnOffsets.findIndex(offsetX);
+    return true;
 }
 
 void TableGrid::handleMouseButton(int mouseX, int mouseY, bool isPressed) {
@@ -393,28 +1333,48 @@ void TableGrid::handleMouseButton(int mouseX, int mouseY, bool isPressed) {
 
     // On press, check if clicking on scrollbar area
     if (isPressed) {
-        if (rows > visibleRows && verticalScrollBar && verticalScrollBar->containsPoint(mouseX, mouseY)) {
+        if (hasVerticalScroll() && verticalScrollBar && verticalScrollBar->containsPoint(mouseX, mouseY)) {
             verticalScrollBar->handleMouseButton(mouseX, mouseY, isPressed);
             return;
         }
-        if (cols > visibleCols && horizontalScrollBar && horizontalScrollBar->containsPoint(mouseX, mouseY)) {
+        if (hasHorizontalScroll() && horizontalScrollBar && horizontalScrollBar->containsPoint(mouseX, mouseY)) {
             horizontalScrollBar->handleMouseButton(mouseX, mouseY, isPressed);
             return;
         }
     }
 
     if (isPressed) {
+        // Header click sorts by that column, a second click reverses it
+        int absY = getAbsoluteY();
+        int headerCol;
+        if (mouseY >= absY && mouseY < absY + headerHeight && getColumnAtX(mouseX, headerCol)) {
+            sortByColumn(headerCol, !(headerCol == sortColumn && sortAscending));
+            return;
+        }
+        if (filterRowVisible && mouseY >= absY + headerHeight && mouseY < absY + getCellAreaTop() &&
+            getColumnAtX(mouseX, headerCol)) {
+            startFilterEdit(headerCol);
+        }
+
         int clickedRow, clickedCol;
         if (getCellAtPosition(mouseX, mouseY, clickedRow, clickedCol)) {
             if (isEditing) {
                 commitCellEdit();
             }
-            selectedRow = clickedRow;
-            selectedCol = clickedCol;
+            if ((keyModifiers & KB_MOD_SHIFT) && selectedRow >= 0 && selectedCol >= 0) {
+                extendSelection(clickedRow, clickedCol);
+            } else if (keyModifiers & KB_MOD_CONTROL) {
+                addSelectionRange(clickedRow, clickedCol);
+            } else {
+                selectCell(clickedRow, clickedCol);
+            }
+            isDragSelecting = true;
         }
     } else {
+        isDragSelecting = false;
         // Double-click to edit (simplified: just edit on second click)
-        if (selectedRow >= 0 && selectedCol >= 0) {
+        bool singleCell = selectionRanges.size() == 1 && extentRow == selectedRow && extentCol == selectedCol;
+        if (singleCell && selectedRow >= 0 && selectedCol >= 0) {
             int clickedRow, clickedCol;
             if (getCellAtPosition(mouseX, mouseY, clickedRow, clickedCol)) {
                 if (clickedRow == selectedRow && clickedCol == selectedCol) {
@@ -430,6 +1390,19 @@ void TableGrid::handleMouseButton(int mouseX, int mouseY, bool isPressed) {
     }
 }
 
+void TableGrid::handleMouseWheel(int mouseX, int mouseY, float delta) {
+    (void)mouseX;
+    (void)mouseY;
+    if (!hasVerticalScroll()) return;
+    if (isEditing) {
+        commitCellEdit();
+    }
+
+    // Three default rows per notch, in pixels so variable heights scroll smoothly
+    scrollY -= (int64_t)(delta * 3 * rowHeight);
+    updateScrollPosition();
+}
+
 void TableGrid::handleMouseMove(int mouseX, int mouseY) {
     if (verticalScrollBar && verticalScrollBar->isDragging()) {
         verticalScrollBar->handleMouseMove(mouseX, mouseY);
@@ -440,31 +1413,56 @@ void TableGrid::handleMouseMove(int mouseX, int mouseY) {
     if (isEditing && activeTextBox) {
         activeTextBox->handleMouseMove(mouseX, mouseY);
     }
+
+    if (isDragSelecting && rows > 0 && cols > 0) {
+        // Past an edge the drag keeps extending to the last cell shown on that side
+        int areaLeft, areaTop, areaRight, areaBottom;
+        getCellAreaRect(areaLeft, areaTop, areaRight, areaBottom);
+        int64_t contentRight = areaLeft + columnOffsets.total() - scrollX;
+        int64_t contentBottom = areaTop + rowOffsets.total() - scrollY;
+        int dragX = (int)std::max<int64_t>(areaLeft, std::min<int64_t>(mouseX, std::min<int64_t>(areaRight, contentRight) - 1));
+        int dragY = (int)std::max<int64_t>(areaTop, std::min<int64_t>(mouseY, std::min<int64_t>(areaBottom, contentBottom) - 1));
+        int row, col;
+        if (getCellAtPosition(dragX, dragY, row, col) && (row != extentRow || col != extentCol)) {
+            extendSelection(row, col);
+            ensureCellVisible(row, col);
+        }
+    }
 }
 
 void TableGrid::handleChar(unsigned int charCode) {
     if (isEditing && activeTextBox) {
         activeTextBox->handleChar(charCode);
+        if (isEditingFilter) {
+            setColumnFilter(filterEditCol, activeTextBox->getText());
+        }
     } else if (selectedRow >= 0 && selectedCol >= 0 && charCode >= 32 && charCode <= 126) {
         // Start editing on printable character
         startCellEdit(selectedRow, selectedCol);
-        cells[selectedRow][selectedCol] = std::string(1, (char)charCode);
-        activeTextBox->setText(cells[selectedRow][selectedCol]);
+        activeTextBox->setText(std::string(1, (char)charCode));
     }
 }
 
 void TableGrid::handleKey(int key, bool isPressed) {
     if (!isPressed) return;
 
-    if (isEditing && activeTextBox) {
+    if (isEditing && isEditingFilter) {
+        // Filters apply as they are typed, so leaving the box only ends the edit
+        if (key == KB_KEY_ENTER || key == KB_KEY_TAB || key == KB_KEY_ESCAPE) {
+            commitCellEdit();
+        } else {
+            activeTextBox->handleKey(key, isPressed);
+            setColumnFilter(filterEditCol, activeTextBox->getText());
+        }
+    } else if (isEditing && activeTextBox) {
         if (key == KB_KEY_ENTER || key == KB_KEY_TAB) {
             commitCellEdit();
 
             // Move selection
             if (key == KB_KEY_ENTER && selectedRow < rows - 1) {
-                selectedRow++;
+                selectCell(selectedRow + 1, selectedCol);
             } else if (key == KB_KEY_TAB && selectedCol < cols - 1) {
-                selectedCol++;
+                selectCell(selectedRow, selectedCol + 1);
             }
         } else if (key == KB_KEY_ESCAPE) {
             isEditing = false;
@@ -472,32 +1470,23 @@ void TableGrid::handleKey(int key, bool isPressed) {
             activeTextBox->handleKey(key, isPressed);
         }
     } else {
-        // Navigation keys
-        if (key == KB_KEY_UP && selectedRow > 0) {
-            selectedRow--;
-            if (selectedRow < scrollOffsetRow) {
-                scrollOffsetRow = selectedRow;
-                verticalScrollBar->setValue(scrollOffsetRow);
-            }
-        } else if (key == KB_KEY_DOWN && selectedRow < rows - 1) {
-            selectedRow++;
-            if (selectedRow >= scrollOffsetRow + visibleRows) {
-                scrollOffsetRow = selectedRow - visibleRows + 1;
-                verticalScrollBar->setValue(scrollOffsetRow);
-            }
-        } else if (key == KB_KEY_LEFT && selectedCol > 0) {
-            selectedCol--;
-            if (selectedCol < scrollOffsetCol) {
-                scrollOffsetCol = selectedCol;
-                horizontalScrollBar->setValue(scrollOffsetCol);
-            }
-        } else if (key == KB_KEY_RIGHT && selectedCol < cols - 1) {
-            selectedCol++;
-            calculateVisibleCells();
-            if (selectedCol >= scrollOffsetCol + visibleCols) {
-                scrollOffsetCol++;
-                horizontalScrollBar->setValue(scrollOffsetCol);
+        // Navigation keys move the active cell, or with shift the extent of its range
+        int rowStep = key == KB_KEY_UP ? -1 : key == KB_KEY_DOWN ? 1 : 0;
+        int colStep = key == KB_KEY_LEFT ? -1 : key == KB_KEY_RIGHT ? 1 : 0;
+        if ((rowStep != 0 || colStep != 0) && rows > 0 && cols > 0) {
+            if (selectedRow < 0 || selectedCol < 0) {
+                selectCell(0, 0);
+            } else {
+                bool extend = (keyModifiers & KB_MOD_SHIFT) != 0;
+                int row = std::max(0, std::min((extend ? extentRow : selectedRow) + rowStep, rows - 1));
+                int col = std::max(0, std::min((extend ? extentCol : selectedCol) + colStep, cols - 1));
+                if (extend) {
+                    extendSelection(row, col);
+                } else {
+                    selectCell(row, col);
+                }
             }
+            ensureCellVisible(extentRow, extentCol);
         } else if (key == KB_KEY_ENTER) {
             if (selectedRow >= 0 && selectedCol >= 0) {
                 startCellEdit(selectedRow, selectedCol);
@@ -510,11 +1499,14 @@ void TableGrid::startCellEdit(int row, int col) {
     if (row < 0 || row >= rows || col < 0 || col >= cols) return;
 
     isEditing = true;
-    selectedRow = row;
-    selectedCol = col;
+    if (row != selectedRow || col != selectedCol) {
+        selectCell(row, col);
+    }
+    ensureCellVisible(row, col);
 
     positionTextBoxForCell(row, col);
-    activeTextBox->setText(cells[row][col]);
+    activeTextBox->setText(formulas && formulas->hasFormula(toModelRow(row), col) ? formulas->getFormula(toModelRow(row), col)
+                                                                               : model->getCellValue(toModelRow(row), col));
     activeTextBox->setFocus(true);
 }
 
@@ -524,20 +1516,41 @@ void TableGrid::positionTextBoxForCell(int row, int col) {
     int colWidth = getColumnWidth(col);
 
     activeTextBox->setPosition(cellX + 1, cellY + 1);
-    activeTextBox->setSize(colWidth - 2, rowHeight - 2);
+    activeTextBox->setSize(colWidth - 2, rowOffsets.get(row) - 2);
 }
 
-void TableGrid::commitCellEdit() {
-    if (!isEditing || selectedRow < 0 || selectedCol < 0) return;
+void TableGrid::startFilterEdit(int col) {
+    if (isEditing) {
+        commitCellEdit();
+    }
+
+    isEditing = true;
+    isEditingFilter = true;
+    filterEditCol = col;
 
-    cells[selectedRow][selectedCol] = activeTextBox->getText();
+    activeTextBox->setPosition(getCellX(col) - getAbsoluteX() + 1, 1 + headerHeight + 1);
+    activeTextBox->setSize(getColumnWidth(col) - 2, rowHeight - 2);
+    activeTextBox->setText(columnFilters[col]);
+    activeTextBox->setFocus(true);
+}
 
-    if (cellChangeCallback) {
-        cellChangeCallback(selectedRow, selectedCol, cells[selectedRow][selectedCol]);
+void TableGrid::commitCellEdit() {
+    if (isEditing && isEditingFilter) {
+        isEditing = false;
+        isEditingFilter = false;
+        activeTextBox->setFocus(false);
+        return;
     }
+    if (!isEditing || selectedRow < 0 || selectedCol < 0) return;
 
     isEditing = false;
     activeTextBox->setFocus(false);
+
+    std::string value = activeTextBox->getText();
+    int modelRow = toModelRow(selectedRow);
+    if (storeCellValue(modelRow, selectedCol, value) && cellChangeCallback) {
+        cellChangeCallback(modelRow, selectedCol, value);
+    }
 }
 
 void TableGrid::setFontRenderer(FontRenderer* renderer) {
@@ -551,29 +1564,59 @@ void TableGrid::setFontRenderer(FontRenderer* renderer) {
     if (activeTextBox) {
         activeTextBox->setFontRenderer(renderer);
     }
+    invalidateCells();
 }
 
 void TableGrid::copy() {
     if (isEditing && activeTextBox) {
         activeTextBox->copy();
+        return;
     }
+    if (selectionRanges.empty()) return;
+
+    copySelection();
 }
 
 void TableGrid::cut() {
     if (isEditing && activeTextBox) {
         activeTextBox->cut();
+        return;
+    }
+    if (selectionRanges.empty()) return;
+
+    // Cells are only cleared once the clipboard tool has taken all of them
+    if (copySelection()) {
+        clearSelectedCells();
     }
 }
 
 void TableGrid::paste() {
     if (isEditing && activeTextBox) {
         activeTextBox->paste();
+        return;
     }
+    if (selectedRow < 0 || selectedCol < 0) return;
+
+    FILE* pipe = openClipboard(false);
+    if (!pipe) return;
+    std::string text;
+    std::vector<char> chunk(1 << 16);
+    size_t count;
+    while ((count = std::fread(chunk.data(), 1, chunk.size(), pipe)) > 0) {
+        text.append(chunk.data(), count);
+    }
+    pclose(pipe);
+    pasteDelimited(text.data(), text.size(), '\t');
 }
 
 void TableGrid::selectAll() {
     if (isEditing && activeTextBox) {
         activeTextBox->selectAll();
+        return;
+    }
+    if (rows > 0 && cols > 0) {
+        selectCell(0, 0);
+        extendSelection(rows - 1, cols - 1);
     }
 }
 
@@ -581,54 +1624,267 @@ bool TableGrid::hasSelection() const {
     if (isEditing && activeTextBox) {
         return activeTextBox->hasSelection();
     }
-    return false;
+    return !selectionRanges.empty();
+}
+
+bool TableGrid::copySelection() {
+    FILE* pipe = openClipboard(true);
+    if (!pipe) {
+        std::cerr << "Failed to open the clipboard" << std::endl;
+        return false;
+    }
+    bool written = writeSelection(pipe, '\t');
+    bool closed = pclose(pipe) == 0;
+    if (!written || !closed) {
+        std::cerr << "Failed to copy the selection to the clipboard" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Rows are appended from the model straight into one buffer, which is written out each
+// time it passes CLIPBOARD_FLUSH_BYTES, so no string is built per cell or for the whole copy
+bool TableGrid::writeSelection(FILE* file, char delimiter) {
+    std::string buffer;
+    bool ok = true;
+    for (const CellRange& range : selectionRanges) {
+        int lastRow = std::min(range.lastRow, rows - 1);
+        int colCount = std::min(range.lastCol, cols - 1) - range.firstCol + 1;
+        if (colCount <= 0) continue;
+        for (int row = range.firstRow; ok && row <= lastRow; row++) {
+            model->appendCellRange(toModelRow(row), range.firstCol, 1, colCount, delimiter, buffer);
+            if (buffer.size() >= CLIPBOARD_FLUSH_BYTES) {
+                ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+                buffer.clear();
+            }
+        }
+    }
+    if (ok && !buffer.empty()) {
+        ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    }
+    return ok;
+}
+
+void TableGrid::clearSelectedCells() {
+    std::vector<std::string> empty;
+    model->beginUpdate();
+    for (const CellRange& range : selectionRanges) {
+        int lastRow = std::min(range.lastRow, rows - 1);
+        int colCount = std::min(range.lastCol, cols - 1) - range.firstCol + 1;
+        if (colCount <= 0) continue;
+        empty.assign(colCount, std::string());
+        for (int row = range.firstRow; row <= lastRow; row++) {
+            setCellRange(toModelRow(row), range.firstCol, 1, colCount, empty);
+        }
+    }
+    model->endUpdate();
+}
+
+// Records go to consecutive view rows from the active cell, as one update; fields past the
+// last column and records past the last row are dropped. The pasted block is selected.
+void TableGrid::pasteDelimited(const char* data, size_t size, char delimiter) {
+    if (selectedRow < 0 || selectedCol < 0) return;
+
+    // Field strings are reused from record to record
+    std::vector<std::string> fields;
+    int maxFields = cols - selectedCol;
+    int fieldCount = 0;
+    int widest = 0;
+    int viewRow = selectedRow;
+    model->beginUpdate();
+    DelimitedText::parse(data, data + size, delimiter,
+        [&](int col, const char* text, size_t length, bool escaped) {
+            if (col >= maxFields) return;
+            if (col == (int)fields.size()) {
+                fields.emplace_back();
+            }
+            if (escaped) {
+                DelimitedText::unescape(text, length, fields[col]);
+            } else {
+                fields[col].assign(text, length);
+            }
+            fieldCount = col + 1;
+        },
+        [&]() {
+            if (viewRow < rows && fieldCount > 0) {
+                setCellRange(toModelRow(viewRow), selectedCol, 1, fieldCount, fields);
+                widest = std::max(widest, fieldCount);
+                viewRow++;
+            }
+            fieldCount = 0;
+        });
+    model->endUpdate();
+
+    if (widest > 0) {
+        extendSelection(viewRow - 1, selectedCol + widest - 1);
+    }
 }
 
 void TableGrid::setCellValue(int row, int col, const std::string& value) {
-    if (row >= 0 && row < rows && col >= 0 && col < cols) {
-        cells[row][col] = value;
+    if (row >= 0 && row < modelRows && col >= 0 && col < cols) {
+        storeCellValue(row, col, value);
+    }
+}
+
+bool TableGrid::storeCellValue(int row, int col, const std::string& value) {
+    if (FormulaEngine::isFormula(value)) {
+        if (!formulas) {
+            formulas = new FormulaEngine(model);
+        }
+        formulas->setFormula(row, col, value);
+        return true;
+    }
+    if (formulas) {
+        formulas->removeFormula(row, col);
     }
+    return model->setCellValue(row, col, value);
+}
+
+bool TableGrid::setCellRange(int firstRow, int firstCol, int rowCount, int colCount, const std::vector<std::string>& values) {
+    if (rowCount <= 0 || colCount <= 0 || values.size() < (size_t)rowCount * colCount) return false;
+
+    // Without formulas involved the model can take the whole block at once
+    bool hasFormulaValue = std::any_of(values.begin(), values.begin() + (size_t)rowCount * colCount,
+                                       [](const std::string& value) { return FormulaEngine::isFormula(value); });
+    if (!hasFormulaValue && (!formulas || formulas->getFormulaCount() == 0)) {
+        return model->setCellRange(firstRow, firstCol, rowCount, colCount, values);
+    }
+
+    bool allSet = true;
+    model->beginUpdate();
+    for (int r = 0; r < rowCount; r++) {
+        for (int c = 0; c < colCount; c++) {
+            int row = firstRow + r;
+            int col = firstCol + c;
+            if (row < 0 || row >= modelRows || col < 0 || col >= cols) {
+                allSet = false;
+                continue;
+            }
+            allSet = storeCellValue(row, col, values[(size_t)r * colCount + c]) && allSet;
+        }
+    }
+    model->endUpdate();
+    return allSet;
+}
+
+void TableGrid::beginUpdate() {
+    model->beginUpdate();
+}
+
+void TableGrid::endUpdate() {
+    model->endUpdate();
+}
+
+std::string TableGrid::getCellFormula(int row, int col) const {
+    return formulas ? formulas->getFormula(row, col) : std::string();
 }
 
 std::string TableGrid::getCellValue(int row, int col) const {
-    if (row >= 0 && row < rows && col >= 0 && col < cols) {
-        return cells[row][col];
+    if (row >= 0 && row < modelRows && col >= 0 && col < cols) {
+        return model->getCellValue(row, col);
     }
     return "";
 }
 
 void TableGrid::setRowCount(int newRows) {
-    if (newRows < 1) return;
-
-    cells.resize(newRows);
-    for (int r = rows; r < newRows; r++) {
-        cells[r].resize(cols, "");
+    VectorTableModel* vectorModel = dynamic_cast<VectorTableModel*>(model);
+    if (vectorModel) {
+        vectorModel->setRowCount(newRows);
     }
-    rows = newRows;
-    updateScrollBars();
 }
 
 void TableGrid::setColCount(int newCols) {
-    if (newCols < 1) return;
-
-    for (int r = 0; r < rows; r++) {
-        cells[r].resize(newCols, "");
+    VectorTableModel* vectorModel = dynamic_cast<VectorTableModel*>(model);
+    if (vectorModel) {
+        vectorModel->setColCount(newCols);
     }
-    columnWidths.resize(newCols, defaultColumnWidth);
-    cols = newCols;
-    updateScrollBars();
 }
 
 void TableGrid::setSelectedCell(int row, int col) {
-    if (row >= 0 && row < rows && col >= 0 && col < cols) {
-        selectedRow = row;
-        selectedCol = col;
+    if (row >= 0 && row < modelRows && col >= 0 && col < cols) {
+        int viewRow = toViewRow(row);
+        selectCell(viewRow, viewRow >= 0 ? col : -1);
+    }
+}
+
+void TableGrid::setSelectedRange(int anchorRow, int anchorCol, int extentRow, int extentCol) {
+    if (anchorRow < 0 || anchorRow >= modelRows || extentRow < 0 || extentRow >= modelRows ||
+        anchorCol < 0 || anchorCol >= cols || extentCol < 0 || extentCol >= cols) {
+        return;
+    }
+    int anchorViewRow = toViewRow(anchorRow);
+    int extentViewRow = toViewRow(extentRow);
+    if (anchorViewRow < 0 || extentViewRow < 0) return;
+    selectCell(anchorViewRow, anchorCol);
+    extendSelection(extentViewRow, extentCol);
+}
+
+// Selection changes repaint the old and new ranges; the active cell is tracked by the cache
+void TableGrid::selectCell(int row, int col) {
+    for (const CellRange& range : selectionRanges) {
+        invalidateViewRange(range);
     }
+    selectionRanges.clear();
+    selectedRow = row;
+    selectedCol = col;
+    extentRow = row;
+    extentCol = col;
+    if (row >= 0 && col >= 0) {
+        selectionRanges.push_back({row, col, row, col});
+    }
+}
+
+void TableGrid::extendSelection(int row, int col) {
+    if (selectedRow < 0 || selectedCol < 0 || selectionRanges.empty()) {
+        selectCell(row, col);
+        return;
+    }
+    CellRange& range = selectionRanges.back();
+    invalidateViewRange(range);
+    extentRow = row;
+    extentCol = col;
+    range.firstRow = std::min(selectedRow, row);
+    range.lastRow = std::max(selectedRow, row);
+    range.firstCol = std::min(selectedCol, col);
+    range.lastCol = std::max(selectedCol, col);
+    invalidateViewRange(range);
+}
+
+void TableGrid::addSelectionRange(int row, int col) {
+    selectedRow = row;
+    selectedCol = col;
+    extentRow = row;
+    extentCol = col;
+    selectionRanges.push_back({row, col, row, col});
+}
+
+bool TableGrid::isCellSelected(int row, int col) const {
+    for (const CellRange& range : selectionRanges) {
+        if (row >= range.firstRow && row <= range.lastRow && col >= range.firstCol && col <= range.lastCol) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TableGrid::invalidateViewRange(const CellRange& range) {
+    int firstRow = std::max(range.firstRow, 0);
+    int firstCol = std::max(range.firstCol, 0);
+    // Offsets can lag behind rows and cols while the view is being rebuilt
+    int lastRow = std::min({range.lastRow, rows - 1, rowOffsets.size() - 1});
+    int lastCol = std::min({range.lastCol, cols - 1, columnOffsets.size() - 1});
+    if (firstRow > lastRow || firstCol > lastCol) return;
+    invalidateContentRect(columnOffsets.prefixSum(firstCol), rowOffsets.prefixSum(firstRow),
+                          columnOffsets.prefixSum(lastCol + 1), rowOffsets.prefixSum(lastRow + 1));
+}
+
+int TableGrid::getSelectedRow() const {
+    return (selectedRow >= 0 && selectedRow < rows) ? toModelRow(selectedRow) : -1;
 }
 
 void TableGrid::setColumnWidth(int col, int width) {
-    if (col >= 0 && col < (int)columnWidths.size() && width > 0) {
-        columnWidths[col] = width;
+    if (col >= 0 && col < columnOffsets.size() && width > 0) {
+        columnOffsets.set(col, width);
         updateScrollBars();
     }
 }
@@ -642,6 +1898,23 @@ void TableGrid::setDefaultColumnWidth(int width) {
 void TableGrid::setRowHeight(int height) {
     if (height > 0) {
         rowHeight = height;
+        rebuildRowOffsets();
+        updateScrollBars();
+    }
+}
+
+void TableGrid::setRowHeight(int row, int height) {
+    if (row < 0 || row >= modelRows || height < 0) return;
+
+    if (rowHeights.empty()) {
+        if (height == 0) return;
+        rowHeights.assign(modelRows, 0);
+    }
+    rowHeights[row] = height;
+
+    int viewRow = toViewRow(row);
+    if (viewRow >= 0) {
+        rowOffsets.set(viewRow, height > 0 ? height : rowHeight);
         updateScrollBars();
     }
 }
@@ -666,10 +1939,12 @@ void TableGrid::setCellChangeCallback(std::function<void(int, int, const std::st
 
 void TableGrid::setBackgroundColor(uint32_t color) {
     backgroundColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setCellBackgroundColor(uint32_t color) {
     cellBackgroundColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setHeaderBackgroundColor(uint32_t color) {
@@ -678,18 +1953,22 @@ void TableGrid::setHeaderBackgroundColor(uint32_t color) {
 
 void TableGrid::setSelectedBackgroundColor(uint32_t color) {
     selectedBackgroundColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setHoverBackgroundColor(uint32_t color) {
     hoverBackgroundColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setGridLineColor(uint32_t color) {
     gridLineColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setTextColor(uint32_t color) {
     textColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setHeaderTextColor(uint32_t color) {
@@ -698,6 +1977,7 @@ void TableGrid::setHeaderTextColor(uint32_t color) {
 
 void TableGrid::setSelectedTextColor(uint32_t color) {
     selectedTextColor = color;
+    invalidateCells();
 }
 
 void TableGrid::setBorderColor(uint32_t color) {
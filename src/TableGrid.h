@@ -4,36 +4,119 @@
 #include "Widget.h"
 #include "ScrollBar.h"
 #include "TextBox.h"
+#include "TableModel.h"
+#include "TableIndex.h"
+#include "FenwickTree.h"
+#include "FormulaEngine.h"
+#include <algorithm>
+#include <cstdio>
 #include <vector>
 #include <string>
 #include <functional>
 
 class TableGrid : public Widget {
+public:
+    // Inclusive block of cells; rows are view rows
+    struct CellRange {
+        int firstRow, firstCol, lastRow, lastCol;
+    };
+
 private:
-    // Data storage
-    std::vector<std::vector<std::string>> cells;
+    // Data source; the grid owns the built-in model it creates itself
+    TableModel* model;
+    bool ownsModel;
+    int modelListenerId;
+    int modelRows;
+    // Rows shown after filtering, and columns
     int rows;
     int cols;
 
-    // Selection and editing
+    // Values of the cells in the viewport, fetched from the model once per frame
+    std::vector<std::string> visibleValues;
+    std::vector<std::string> rowValues;
+
+    // Formulas by model cell; created with the first one entered
+    FormulaEngine* formulas;
+
+    // View rows map to model rows through rowOrder; empty means the model's own order.
+    // Rows in the model never move, so edits and callbacks keep their model row ids.
+    std::vector<int> rowOrder;
+    std::vector<int> viewRowOf;
+    std::vector<int> sortedOrder;
+    int sortColumn;
+    bool sortAscending;
+
+    // Filters keep the rows whose text contains each column's filter, ignoring case
+    std::vector<std::string> columnFilters;
+    TableIndex* searchIndex;
+    bool filterRowVisible;
+    bool isEditingFilter;
+    int filterEditCol;
+
+    // Selection and editing. selectedRow/Col is the active cell and the anchor of the last
+    // range, which runs from it to the extent; ctrl-click starts another range.
     int selectedRow;
     int selectedCol;
+    int extentRow;
+    int extentCol;
+    std::vector<CellRange> selectionRanges;
+    bool isDragSelecting;
     int hoveredRow;
     int hoveredCol;
     TextBox* activeTextBox;
     bool isEditing;
 
-    // Scroll state
+    // Scroll state; positions are in pixels, the first and count of the scrolling rows and
+    // columns at least partly on screen are derived from them
+    int64_t scrollY;
+    int64_t scrollX;
     int scrollOffsetRow;
     int scrollOffsetCol;
     int visibleRows;
     int visibleCols;
 
-    // Dimensions
+    // Leading view rows and columns that stay in place; their size in pixels is clipped to
+    // the viewport, and the scrolled cells start right after them
+    int frozenRows;
+    int frozenCols;
+    int frozenHeight;
+    int frozenWidth;
+
+    // Part of the cell cache in viewport coordinates, showing content offset by the scroll
+    // position along the axes it scrolls. Only the dirty rectangle (exclusive right/bottom)
+    // is redrawn.
+    struct CachePane {
+        int left, top, right, bottom;
+        bool scrollsX, scrollsY;
+        bool dirty;
+        int dirtyLeft, dirtyTop, dirtyRight, dirtyBottom;
+    };
+
+    // Cell area rendered in viewport coordinates as four panes: frozen corner, frozen rows,
+    // frozen columns and the body. Scrolling moves the pixels of the panes that scroll and
+    // dirties only the strip scrolled into view. cacheScrollX/Y is the position the
+    // pixels were drawn at.
+    std::vector<uint32_t> cellCache;
+    int cacheWidth;
+    int cacheHeight;
+    CachePane panes[4];
+    int64_t cacheScrollX;
+    int64_t cacheScrollY;
+    // Highlights the cache was drawn with
+    int drawnSelectedRow;
+    int drawnSelectedCol;
+    int drawnHoveredRow;
+    int drawnHoveredCol;
+    bool drawnEditing;
+
+    // Dimensions. Row heights are kept per model row (0 means rowHeight) and summed in view
+    // order, column widths are summed in column order.
     int rowHeight;
     int headerHeight;
     int headerWidth;
-    std::vector<int> columnWidths;
+    std::vector<int> rowHeights;
+    FenwickTree rowOffsets;
+    FenwickTree columnOffsets;
     int defaultColumnWidth;
 
     // Scrollbars
@@ -46,6 +129,7 @@ private:
     uint32_t cellBackgroundColor;
     uint32_t headerBackgroundColor;
     uint32_t selectedBackgroundColor;
+    uint32_t rangeBackgroundColor;
     uint32_t hoverBackgroundColor;
     uint32_t gridLineColor;
     uint32_t textColor;
@@ -57,28 +141,72 @@ private:
     std::function<void(int, int, const std::string&)> cellChangeCallback;
 
     // Helper methods
+    void attachModel(TableModel* newModel, bool takeOwnership);
+    void detachModel();
+    void handleModelChange(const TableChange& change);
+    bool storeCellValue(int row, int col, const std::string& value);
     void updateScrollBars();
+    void updateScrollPosition();
+    void sortRows();
+    void applyFilters();
+    void updateRowOrder(bool resort);
+    int toModelRow(int viewRow) const { return rowOrder.empty() ? viewRow : rowOrder[viewRow]; }
+    int toViewRow(int modelRow) const;
+    void buildViewRowIndex();
+    void rebuildRowOffsets();
+    int getCellAreaTop() const { return headerHeight + (filterRowVisible ? rowHeight : 0); }
+    int getViewportWidth() const { return std::max(0, width - 2 - headerWidth - scrollBarWidth); }
+    int getViewportHeight() const { return std::max(0, height - 2 - getCellAreaTop() - scrollBarWidth); }
+    bool hasVerticalScroll() const { return rowOffsets.total() > getViewportHeight(); }
+    bool hasHorizontalScroll() const { return columnOffsets.total() > getViewportWidth(); }
+    void layoutScrollBars();
+    void getCellAreaRect(int& left, int& top, int& right, int& bottom);
+    bool getColumnAtX(int mouseX, int& col);
+    void startFilterEdit(int col);
+    void ensureCellVisible(int row, int col);
     void calculateVisibleCells();
     bool getCellAtPosition(int mouseX, int mouseY, int& row, int& col);
     void positionTextBoxForCell(int row, int col);
     void commitCellEdit();
     void startCellEdit(int row, int col);
-    void drawCell(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int col, int cellX, int cellY, int cellWidth, int cellHeight);
-    void drawRowHeader(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int headerY);
+    void selectCell(int row, int col);
+    void extendSelection(int row, int col);
+    void addSelectionRange(int row, int col);
+    bool isCellSelected(int row, int col) const;
+    void invalidateViewRange(const CellRange& range);
+    bool copySelection();
+    bool writeSelection(FILE* file, char delimiter);
+    void clearSelectedCells();
+    void pasteDelimited(const char* data, size_t size, char delimiter);
+    void drawCell(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int col, int cellX, int cellY, int cellWidth, int cellHeight,
+                  const std::string& cellText, int clipLeft, int clipTop, int clipRight, int clipBottom);
+    void layoutPanes();
+    void scrollCellCache();
+    void renderPane(CachePane& pane);
+    void renderCellCache();
+    void invalidateCells();
+    void invalidatePaneRect(CachePane& pane, int64_t left, int64_t top, int64_t right, int64_t bottom);
+    void invalidateContentRect(int64_t left, int64_t top, int64_t right, int64_t bottom);
+    void invalidateCell(int row, int col);
+    void invalidateModelCells(int firstRow, int firstCol, int lastRow, int lastCol);
+    void drawRowHeader(uint32_t* buffer, int bufferWidth, int bufferHeight, int row, int headerY, int headerRowHeight);
     void drawColumnHeader(uint32_t* buffer, int bufferWidth, int bufferHeight, int col, int headerX, int colWidth);
+    void drawFilterCell(uint32_t* buffer, int bufferWidth, int bufferHeight, int col, int cellX, int colWidth);
     int getCellX(int col);
     int getCellY(int row);
-    int getColumnWidth(int col);
     std::string getColumnLabel(int col);
 
 public:
     TableGrid(int x, int y, int width, int height, int rows, int cols);
+    // Shows an external model; the grid does not take ownership
+    TableGrid(int x, int y, int width, int height, TableModel* model);
     ~TableGrid();
 
     void draw(uint32_t* buffer, int bufferWidth, int bufferHeight) override;
     void checkHover(int mouseX, int mouseY) override;
     void handleMouseButton(int mouseX, int mouseY, bool isPressed) override;
     void handleMouseMove(int mouseX, int mouseY) override;
+    void handleMouseWheel(int mouseX, int mouseY, float delta) override;
     void handleChar(unsigned int charCode) override;
     void handleKey(int key, bool isPressed) override;
     void setFontRenderer(FontRenderer* renderer) override;
@@ -89,23 +217,88 @@ public:
     void selectAll() override;
     bool hasSelection() const override;
 
-    // Data access
+    // Data access; row arguments are model rows, independent of the current sort.
+    // Values starting with '=' are formulas (see FormulaEngine): the model holds their
+    // results, and cells depending on an edited cell are recalculated.
+    void setModel(TableModel* newModel);
+    TableModel* getModel() const { return model; }
     void setCellValue(int row, int col, const std::string& value);
     std::string getCellValue(int row, int col) const;
+    // Formula text of a cell, or empty when it holds a plain value
+    std::string getCellFormula(int row, int col) const;
+    // Writes a block laid out like TableModel::getCellRange's. Formulas, the search index
+    // and the view catch up once for the whole block.
+    bool setCellRange(int firstRow, int firstCol, int rowCount, int colCount, const std::vector<std::string>& values);
+    // Groups any number of edits, from the grid or straight on the model, into one change
+    void beginUpdate();
+    void endUpdate();
+    // Row and column counts can only be changed on the built-in model
     void setRowCount(int newRows);
     void setColCount(int newCols);
-    int getRowCount() const { return rows; }
+    int getRowCount() const { return modelRows; }
+    // Rows left after filtering
+    int getVisibleRowCount() const { return rows; }
     int getColCount() const { return cols; }
 
-    // Selection
+    // CSV/TSV files. Import replaces the model with a ColumnarTableModel owned by the grid
+    // and clears the sort and filters; export writes the rows currently shown, in view order,
+    // streaming blocks formatted on the worker pool.
+    bool importDelimited(const std::string& filepath, char delimiter = ',', bool firstRowIsHeader = true);
+    bool exportDelimited(const std::string& filepath, char delimiter = ',', bool writeHeader = true);
+
+    // Sorting; clicking a column header sorts by it and a second click reverses the order.
+    // The order is taken when sorting and is not updated as cells change.
+    void sortByColumn(int col, bool ascending = true);
+    void clearSort();
+    int getSortColumn() const { return sortColumn; }
+    bool isSortAscending() const { return sortAscending; }
+    // Model row shown at a view position
+    int getModelRow(int viewRow) const;
+
+    // Filtering; the filter row under the headers edits these and applies them per keystroke.
+    // Like sorting, the filtered rows are not re-evaluated as cells change.
+    void setColumnFilter(int col, const std::string& text);
+    std::string getColumnFilter(int col) const;
+    void clearFilters();
+    void setFilterRowVisible(bool visible);
+    bool isFilterRowVisible() const { return filterRowVisible; }
+
+    // Selects the next cell containing text after the selection, wrapping around, and
+    // scrolls it into view; returns false when no visible cell matches
+    bool findNext(const std::string& text, bool forward = true);
+
+    // Scrolling in pixels; 0 puts the first row and column after the frozen ones next to them
+    void setScrollPosition(int64_t x, int64_t y);
+    int64_t getScrollX() const { return scrollX; }
+    int64_t getScrollY() const { return scrollY; }
+
+    // Frozen panes: the first rows and columns in view order stay on screen while the others
+    // scroll beneath them
+    void setFrozenRows(int count);
+    void setFrozenCols(int count);
+    int getFrozenRows() const { return frozenRows; }
+    int getFrozenCols() const { return frozenCols; }
+
+    // Selection. Shift-click, shift-arrows and dragging extend a range from the active cell;
+    // ctrl-click adds another. Copy puts the ranges on the clipboard as TSV, one after
+    // another, and paste writes TSV from the clipboard starting at the active cell.
     void setSelectedCell(int row, int col);
-    int getSelectedRow() const { return selectedRow; }
+    int getSelectedRow() const;
     int getSelectedCol() const { return selectedCol; }
+    // Selects from an anchor cell, which becomes active, to an extent cell. Rows are model
+    // rows; the range covers the view rows between them.
+    void setSelectedRange(int anchorRow, int anchorCol, int extentRow, int extentCol);
+    // Ranges in view rows; the last one contains the active cell
+    const std::vector<CellRange>& getSelectedRanges() const { return selectionRanges; }
 
-    // Layout
+    // Layout; setRowHeight(height) sets the height of every row without its own
     void setColumnWidth(int col, int width);
+    int getColumnWidth(int col) const;
     void setDefaultColumnWidth(int width);
     void setRowHeight(int height);
+    // Height of one model row; 0 returns it to the shared height
+    void setRowHeight(int row, int height);
+    int getRowHeight(int row) const;
     void setHeaderHeight(int height);
     void setHeaderWidth(int width);
 
@@ -117,6 +310,7 @@ public:
     void setCellBackgroundColor(uint32_t color);
     void setHeaderBackgroundColor(uint32_t color);
     void setSelectedBackgroundColor(uint32_t color);
+    void setRangeBackgroundColor(uint32_t color);
     void setHoverBackgroundColor(uint32_t color);
     void setGridLineColor(uint32_t color);
     void setTextColor(uint32_t color);
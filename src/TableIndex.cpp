@@ -0,0 +1,267 @@
+#include "TableIndex.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+namespace {
+
+const int SNAPSHOT_CHUNK_ROWS = 1 << 14;
+
+void toLowerAscii(std::string& text) {
+    for (char& ch : text) {
+        if (ch >= 'A' && ch <= 'Z') {
+            ch = (char)(ch - 'A' + 'a');
+        }
+    }
+}
+
+uint32_t trigramAt(const std::string& text, size_t pos) {
+    return ((uint32_t)(uint8_t)text[pos] << 16) | ((uint32_t)(uint8_t)text[pos + 1] << 8) |
+           (uint32_t)(uint8_t)text[pos + 2];
+}
+
+void collectTrigrams(const std::string& text, std::vector<uint32_t>& grams) {
+    grams.clear();
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+        grams.push_back(trigramAt(text, i));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+}
+
+// Rows containing each trigram, in ascending row order
+struct TableIndex::Postings {
+    std::unordered_map<uint32_t, std::vector<int>> rows;
+};
+
+// Written by the builder job; postings may be read once ready is set
+struct TableIndex::BuildState {
+    std::atomic<bool> ready{false};
+    std::atomic<bool> cancelled{false};
+    std::shared_ptr<const Postings> postings;
+};
+
+TableIndex::TableIndex(const TableModel* model) : model(model), rowCount(0) {
+    clear();
+}
+
+TableIndex::~TableIndex() {
+    for (ColumnIndex& column : columns) {
+        if (column.build) {
+            column.build->cancelled = true;
+        }
+    }
+}
+
+void TableIndex::clear() {
+    for (ColumnIndex& column : columns) {
+        if (column.build) {
+            column.build->cancelled = true;
+        }
+    }
+    columns.clear();
+    rowCount = model->getRowCount();
+    columns.resize(model->getColCount());
+}
+
+void TableIndex::indexColumn(int col) {
+    if (col < 0 || col >= (int)columns.size()) return;
+
+    ColumnIndex& column = columns[col];
+    if (column.build) {
+        column.build->cancelled = true;
+    }
+    column = ColumnIndex();
+
+    std::shared_ptr<std::vector<std::string>> text = std::make_shared<std::vector<std::string>>(rowCount);
+    int rows = rowCount;
+    int chunkCount = (rows + SNAPSHOT_CHUNK_ROWS - 1) / SNAPSHOT_CHUNK_ROWS;
+    WorkerPool::shared().parallelFor(chunkCount, [this, col, rows, &text](int chunk) {
+        int end = std::min(rows, (chunk + 1) * SNAPSHOT_CHUNK_ROWS);
+        for (int row = chunk * SNAPSHOT_CHUNK_ROWS; row < end; row++) {
+            std::string value = model->getCellValue(row, col);
+            toLowerAscii(value);
+            (*text)[row] = std::move(value);
+        }
+    });
+
+    std::shared_ptr<BuildState> build = std::make_shared<BuildState>();
+    column.text = text;
+    column.build = build;
+
+    std::shared_ptr<const std::vector<std::string>> snapshot = text;
+    WorkerPool::shared().submit([build, snapshot]() {
+        std::shared_ptr<Postings> postings = std::make_shared<Postings>();
+        std::vector<uint32_t> grams;
+        for (int row = 0; row < (int)snapshot->size(); row++) {
+            if ((row & 4095) == 0 && build->cancelled.load()) return;
+            collectTrigrams((*snapshot)[row], grams);
+            for (uint32_t gram : grams) {
+                postings->rows[gram].push_back(row);
+            }
+        }
+        build->postings = postings;
+        build->ready.store(true);
+    });
+}
+
+bool TableIndex::isColumnIndexed(int col) const {
+    return col >= 0 && col < (int)columns.size() && columns[col].text != nullptr;
+}
+
+bool TableIndex::isColumnReady(int col) const {
+    return isColumnIndexed(col) && columns[col].build->ready.load();
+}
+
+const std::string& TableIndex::getRowText(const ColumnIndex& column, int row) const {
+    if (!column.editedText.empty()) {
+        std::unordered_map<int, std::string>::const_iterator it = column.editedText.find(row);
+        if (it != column.editedText.end()) return it->second;
+    }
+    return (*column.text)[row];
+}
+
+void TableIndex::scanRows(const ColumnIndex& column, const std::string& query, std::vector<int>& matches) const {
+    int rows = rowCount;
+    int chunkCount = (rows + SNAPSHOT_CHUNK_ROWS - 1) / SNAPSHOT_CHUNK_ROWS;
+    std::vector<std::vector<int>> chunkMatches(chunkCount);
+    WorkerPool::shared().parallelFor(chunkCount, [&](int chunk) {
+        int end = std::min(rows, (chunk + 1) * SNAPSHOT_CHUNK_ROWS);
+        for (int row = chunk * SNAPSHOT_CHUNK_ROWS; row < end; row++) {
+            if (getRowText(column, row).find(query) != std::string::npos) {
+                chunkMatches[chunk].push_back(row);
+            }
+        }
+    });
+
+    matches.clear();
+    for (const std::vector<int>& found : chunkMatches) {
+        matches.insert(matches.end(), found.begin(), found.end());
+    }
+}
+
+bool TableIndex::getPostingCandidates(const ColumnIndex& column, const std::string& query,
+                                      std::vector<int>& candidates) const {
+    if (query.size() < 3 || !column.build->ready.load()) return false;
+
+    // Intersect the query's trigram lists, shortest first
+    std::vector<uint32_t> grams;
+    collectTrigrams(query, grams);
+    std::vector<const std::vector<int>*> lists;
+    bool missing = false;
+    for (uint32_t gram : grams) {
+        std::unordered_map<uint32_t, std::vector<int>>::const_iterator it = column.build->postings->rows.find(gram);
+        if (it == column.build->postings->rows.end()) {
+            missing = true;
+            break;
+        }
+        lists.push_back(&it->second);
+    }
+
+    candidates.clear();
+    if (!missing) {
+        std::sort(lists.begin(), lists.end(), [](const std::vector<int>* a, const std::vector<int>* b) {
+            return a->size() < b->size();
+        });
+        candidates = *lists[0];
+        std::vector<int> narrowed;
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            narrowed.clear();
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+    }
+
+    // Postings describe the snapshot, so edited rows are always rechecked
+    if (!column.editedText.empty()) {
+        std::vector<int> edited;
+        for (const std::pair<const int, std::string>& entry : column.editedText) {
+            edited.push_back(entry.first);
+        }
+        std::sort(edited.begin(), edited.end());
+        std::vector<int> merged;
+        std::set_union(candidates.begin(), candidates.end(), edited.begin(), edited.end(), std::back_inserter(merged));
+        candidates.swap(merged);
+    }
+    return true;
+}
+
+void TableIndex::findRows(int col, const std::string& query, std::vector<uint64_t>& bitmap) {
+    bitmap.assign((rowCount + 63) / 64, 0);
+    if (col < 0 || col >= (int)columns.size()) return;
+
+    if (query.empty()) {
+        for (int row = 0; row < rowCount; row++) {
+            bitmap[row >> 6] |= (uint64_t)1 << (row & 63);
+        }
+        return;
+    }
+
+    if (!isColumnIndexed(col)) {
+        indexColumn(col);
+    }
+    ColumnIndex& column = columns[col];
+    std::string lowered = query;
+    toLowerAscii(lowered);
+
+    // Narrow to the smaller of the previous query's matches and the trigram candidates
+    std::vector<int> candidates;
+    bool haveCandidates = false;
+    if (column.hasLastQuery && lowered.find(column.lastQuery) != std::string::npos) {
+        candidates = column.lastMatches;
+        haveCandidates = true;
+    }
+    std::vector<int> posted;
+    if (getPostingCandidates(column, lowered, posted) && (!haveCandidates || posted.size() < candidates.size())) {
+        candidates.swap(posted);
+        haveCandidates = true;
+    }
+
+    std::vector<int> matches;
+    if (haveCandidates) {
+        for (int row : candidates) {
+            if (getRowText(column, row).find(lowered) != std::string::npos) {
+                matches.push_back(row);
+            }
+        }
+    } else {
+        scanRows(column, lowered, matches);
+    }
+
+    for (int row : matches) {
+        bitmap[row >> 6] |= (uint64_t)1 << (row & 63);
+    }
+    column.hasLastQuery = true;
+    column.lastQuery = lowered;
+    column.lastMatches.swap(matches);
+}
+
+void TableIndex::updateCells(int firstRow, int firstCol, int lastRow, int lastCol) {
+    firstRow = std::max(firstRow, 0);
+    lastRow = std::min(lastRow, rowCount - 1);
+    firstCol = std::max(firstCol, 0);
+    lastCol = std::min(lastCol, (int)columns.size() - 1);
+
+    for (int col = firstCol; col <= lastCol; col++) {
+        ColumnIndex& column = columns[col];
+        if (!column.text) continue;
+
+        // Large rewrites are cheaper to snapshot again the next time the column is searched
+        if ((lastRow - firstRow + 1) + (int)column.editedText.size() > rowCount / 4 + 64) {
+            column.build->cancelled = true;
+            column = ColumnIndex();
+            continue;
+        }
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            std::string value = model->getCellValue(row, col);
+            toLowerAscii(value);
+            column.editedText[row] = std::move(value);
+        }
+        column.hasLastQuery = false;
+    }
+}
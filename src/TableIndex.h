@@ -0,0 +1,63 @@
+#ifndef TABLEINDEX_H
+#define TABLEINDEX_H
+
+#include "TableModel.h"
+#include <memory>
+#include <unordered_map>
+
+// Case-insensitive substring search over the columns of a TableModel. A column is
+// snapshotted the first time it is searched; trigram postings for it are then built on
+// the worker pool, and until they are ready queries scan the snapshot instead. Results
+// are bitmaps over model rows with bit (row & 63) of word (row >> 6) set for a match.
+class TableIndex {
+private:
+    struct Postings;
+    struct BuildState;
+
+    struct ColumnIndex {
+        // Lowercased cell text when the column was indexed; shared with the builder
+        std::shared_ptr<const std::vector<std::string>> text;
+        std::shared_ptr<BuildState> build;
+        // Lowercased text of rows edited since the snapshot; always checked directly
+        std::unordered_map<int, std::string> editedText;
+
+        // Last query and its matches, so a query that extends it only rechecks those rows
+        bool hasLastQuery = false;
+        std::string lastQuery;
+        std::vector<int> lastMatches;
+    };
+
+    const TableModel* model;
+    int rowCount;
+    std::vector<ColumnIndex> columns;
+
+    const std::string& getRowText(const ColumnIndex& column, int row) const;
+    void scanRows(const ColumnIndex& column, const std::string& query, std::vector<int>& matches) const;
+    bool getPostingCandidates(const ColumnIndex& column, const std::string& query, std::vector<int>& candidates) const;
+
+public:
+    // The model is not owned and must outlive the index
+    explicit TableIndex(const TableModel* model);
+    ~TableIndex();
+
+    TableIndex(const TableIndex&) = delete;
+    TableIndex& operator=(const TableIndex&) = delete;
+
+    // Snapshots the column now (reading the model from pool threads while the caller
+    // waits) and starts building its postings in the background
+    void indexColumn(int col);
+    bool isColumnIndexed(int col) const;
+    bool isColumnReady(int col) const;
+
+    // Fills bitmap with the rows whose text in col contains query; empty matches all rows
+    void findRows(int col, const std::string& query, std::vector<uint64_t>& bitmap);
+
+    // Keeps indexed columns current after an edit; call with the change's inclusive block
+    void updateCells(int firstRow, int firstCol, int lastRow, int lastCol);
+    // Drops every column, e.g. after the model changed shape
+    void clear();
+
+    int getRowCount() const { return rowCount; }
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "TableModel.h"
+#include "DelimitedText.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+TableModel::TableModel()
+    : nextListenerId(1), updateDepth(0), pendingCells(false), pendingStructure(false),
+      pendingChange({TableChange::CELLS, 0, 0, -1, -1}) {
+}
+
+TableModel::~TableModel() {
+}
+
+void TableModel::dispatchChange(const TableChange& change) {
+    for (auto& listener : listeners) {
+        listener.second(change);
+    }
+}
+
+void TableModel::notifyCellsChanged(int firstRow, int firstCol, int lastRow, int lastCol) {
+    if (updateDepth == 0) {
+        dispatchChange({TableChange::CELLS, firstRow, firstCol, lastRow, lastCol});
+        return;
+    }
+    if (!pendingCells) {
+        pendingCells = true;
+        pendingChange = {TableChange::CELLS, firstRow, firstCol, lastRow, lastCol};
+        return;
+    }
+    pendingChange.firstRow = std::min(pendingChange.firstRow, firstRow);
+    pendingChange.firstCol = std::min(pendingChange.firstCol, firstCol);
+    pendingChange.lastRow = std::max(pendingChange.lastRow, lastRow);
+    pendingChange.lastCol = std::max(pendingChange.lastCol, lastCol);
+}
+
+void TableModel::notifyStructureChanged() {
+    if (updateDepth > 0) {
+        pendingStructure = true;
+        return;
+    }
+    dispatchChange({TableChange::STRUCTURE, 0, 0, getRowCount() - 1, getColCount() - 1});
+}
+
+void TableModel::beginUpdate() {
+    updateDepth++;
+}
+
+void TableModel::endUpdate() {
+    if (updateDepth == 0 || --updateDepth > 0) return;
+
+    // Clear the pending state first so listeners that write back are heard normally
+    bool structure = pendingStructure;
+    bool cells = pendingCells;
+    TableChange change = pendingChange;
+    pendingStructure = false;
+    pendingCells = false;
+    if (structure) {
+        notifyStructureChanged();
+    } else if (cells) {
+        dispatchChange(change);
+    }
+}
+
+ColumnType TableModel::getColumnType(int) const {
+    return ColumnType::STRING;
+}
+
+std::string TableModel::getColumnName(int) const {
+    return "";
+}
+
+bool TableModel::getIntValue(int row, int col, int64_t& value) const {
+    std::string text = getCellValue(row, col);
+    const char* last = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), last, value);
+    return result.ec == std::errc() && result.ptr == last && !text.empty();
+}
+
+bool TableModel::getDoubleValue(int row, int col, double& value) const {
+    std::string text = getCellValue(row, col);
+    const char* last = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), last, value);
+    return result.ec == std::errc() && result.ptr == last && !text.empty() && !std::isnan(value);
+}
+
+void TableModel::getCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                              std::vector<std::string>& values) const {
+    values.resize((size_t)rowCount * colCount);
+    for (int r = 0; r < rowCount; r++) {
+        for (int c = 0; c < colCount; c++) {
+            values[(size_t)r * colCount + c] = getCellValue(firstRow + r, firstCol + c);
+        }
+    }
+}
+
+void TableModel::appendCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                 char delimiter, std::string& out) const {
+    for (int r = 0; r < rowCount; r++) {
+        for (int c = 0; c < colCount; c++) {
+            if (c > 0) out += delimiter;
+            DelimitedText::appendField(out, getCellValue(firstRow + r, firstCol + c), delimiter);
+        }
+        out += '\n';
+    }
+}
+
+bool TableModel::setCellValue(int, int, const std::string&) {
+    return false;
+}
+
+bool TableModel::setCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                              const std::vector<std::string>& values) {
+    bool allSet = true;
+    beginUpdate();
+    for (int r = 0; r < rowCount; r++) {
+        for (int c = 0; c < colCount; c++) {
+            allSet = setCellValue(firstRow + r, firstCol + c, values[(size_t)r * colCount + c]) && allSet;
+        }
+    }
+    endUpdate();
+    return allSet;
+}
+
+int TableModel::addChangeListener(std::function<void(const TableChange&)> listener) {
+    int listenerId = nextListenerId++;
+    listeners.push_back({listenerId, listener});
+    return listenerId;
+}
+
+void TableModel::removeChangeListener(int listenerId) {
+    for (auto it = listeners.begin(); it != listeners.end(); ++it) {
+        if (it->first == listenerId) {
+            listeners.erase(it);
+            return;
+        }
+    }
+}
+
+VectorTableModel::VectorTableModel(int rows, int cols) : rows(rows), cols(cols) {
+    cells.resize(rows);
+    for (int r = 0; r < rows; r++) {
+        cells[r].resize(cols, "");
+    }
+}
+
+std::string VectorTableModel::getCellValue(int row, int col) const {
+    if (row >= 0 && row < rows && col >= 0 && col < cols) {
+        return cells[row][col];
+    }
+    return "";
+}
+
+void VectorTableModel::getCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                    std::vector<std::string>& values) const {
+    values.resize((size_t)rowCount * colCount);
+    for (int r = 0; r < rowCount; r++) {
+        const std::vector<std::string>& row = cells[firstRow + r];
+        for (int c = 0; c < colCount; c++) {
+            values[(size_t)r * colCount + c] = row[firstCol + c];
+        }
+    }
+}
+
+void VectorTableModel::appendCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                       char delimiter, std::string& out) const {
+    for (int r = 0; r < rowCount; r++) {
+        const std::vector<std::string>& row = cells[firstRow + r];
+        for (int c = 0; c < colCount; c++) {
+            if (c > 0) out += delimiter;
+            DelimitedText::appendField(out, row[firstCol + c], delimiter);
+        }
+        out += '\n';
+    }
+}
+
+bool VectorTableModel::setCellValue(int row, int col, const std::string& value) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) return false;
+    cells[row][col] = value;
+    notifyCellsChanged(row, col, row, col);
+    return true;
+}
+
+bool VectorTableModel::setCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                    const std::vector<std::string>& values) {
+    // Cells outside the table are refused; the rest are copied without per-cell notifications
+    int rowStart = std::max(firstRow, 0);
+    int colStart = std::max(firstCol, 0);
+    int rowEnd = std::min(firstRow + rowCount, rows);
+    int colEnd = std::min(firstCol + colCount, cols);
+    for (int row = rowStart; row < rowEnd; row++) {
+        std::vector<std::string>& cellRow = cells[row];
+        size_t rowBase = (size_t)(row - firstRow) * colCount;
+        for (int col = colStart; col < colEnd; col++) {
+            cellRow[col] = values[rowBase + (col - firstCol)];
+        }
+    }
+    if (rowStart < rowEnd && colStart < colEnd) {
+        notifyCellsChanged(rowStart, colStart, rowEnd - 1, colEnd - 1);
+    }
+    return rowStart == firstRow && colStart == firstCol && rowEnd == firstRow + rowCount && colEnd == firstCol + colCount;
+}
+
+void VectorTableModel::setRowCount(int newRows) {
+    if (newRows < 1) return;
+
+    cells.resize(newRows);
+    for (int r = rows; r < newRows; r++) {
+        cells[r].resize(cols, "");
+    }
+    rows = newRows;
+    notifyStructureChanged();
+}
+
+void VectorTableModel::setColCount(int newCols) {
+    if (newCols < 1) return;
+
+    for (int r = 0; r < rows; r++) {
+        cells[r].resize(newCols, "");
+    }
+    cols = newCols;
+    notifyStructureChanged();
+}
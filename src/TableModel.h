@@ -0,0 +1,121 @@
+#ifndef TABLEMODEL_H
+#define TABLEMODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <utility>
+
+// Storage type of a column; models without typed storage report STRING everywhere
+enum class ColumnType {
+    STRING,
+    INT64,
+    DOUBLE
+};
+
+// Change reported to model listeners. CELLS covers the inclusive block of cells whose
+// values changed; STRUCTURE means the row or column count changed and everything is stale.
+struct TableChange {
+    enum Type {
+        CELLS,
+        STRUCTURE
+    };
+
+    Type type;
+    int firstRow;
+    int firstCol;
+    int lastRow;
+    int lastCol;
+};
+
+// Data source behind a TableGrid. The grid only asks for the cells it is about to draw,
+// so a model can page rows in from anywhere; it must report changes through the notify
+// helpers so listening grids stay current.
+class TableModel {
+private:
+    std::vector<std::pair<int, std::function<void(const TableChange&)>>> listeners;
+    int nextListenerId;
+
+    // Changes held back between beginUpdate and endUpdate, merged into one block
+    int updateDepth;
+    bool pendingCells;
+    bool pendingStructure;
+    TableChange pendingChange;
+
+    void dispatchChange(const TableChange& change);
+
+protected:
+    void notifyCellsChanged(int firstRow, int firstCol, int lastRow, int lastCol);
+    void notifyStructureChanged();
+
+public:
+    TableModel();
+    virtual ~TableModel();
+
+    virtual int getRowCount() const = 0;
+    virtual int getColCount() const = 0;
+    virtual std::string getCellValue(int row, int col) const = 0;
+    virtual ColumnType getColumnType(int col) const;
+    // Optional header text; views fall back to their own labels when empty
+    virtual std::string getColumnName(int col) const;
+
+    // Fills values row-major with rowCount x colCount cells starting at firstRow, firstCol.
+    // The default calls getCellValue per cell; models with costly lookups should batch.
+    virtual void getCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                              std::vector<std::string>& values) const;
+    // Appends the block to out as delimited text, one line per row, quoting cells only when
+    // needed (see DelimitedText). Used for export and copying; models override it to
+    // append straight from storage instead of creating a string per cell.
+    virtual void appendCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                                 char delimiter, std::string& out) const;
+
+    // Typed reads used for sorting and filtering; false for empty or non-numeric cells.
+    // The defaults parse getCellValue, typed models answer straight from storage.
+    virtual bool getIntValue(int row, int col, int64_t& value) const;
+    virtual bool getDoubleValue(int row, int col, double& value) const;
+
+    // Read-only by default; editable models return true from setCellValue
+    virtual bool setCellValue(int row, int col, const std::string& value);
+    // Writes values laid out like getCellRange's and reports them as one change. Returns
+    // false if any cell was refused; the others are still written.
+    virtual bool setCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                              const std::vector<std::string>& values);
+
+    // Calls may nest. Until the outermost endUpdate, listeners hear nothing; then they get
+    // one CELLS change covering every changed cell, or one STRUCTURE change if the shape
+    // changed. Values written in between can be read back immediately.
+    void beginUpdate();
+    void endUpdate();
+    bool isUpdating() const { return updateDepth > 0; }
+
+    int addChangeListener(std::function<void(const TableChange&)> listener);
+    void removeChangeListener(int listenerId);
+};
+
+// Built-in model keeping every cell as its own string
+class VectorTableModel : public TableModel {
+private:
+    std::vector<std::vector<std::string>> cells;
+    int rows;
+    int cols;
+
+public:
+    VectorTableModel(int rows, int cols);
+
+    int getRowCount() const override { return rows; }
+    int getColCount() const override { return cols; }
+    std::string getCellValue(int row, int col) const override;
+    void getCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                      std::vector<std::string>& values) const override;
+    void appendCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                         char delimiter, std::string& out) const override;
+    bool setCellValue(int row, int col, const std::string& value) override;
+    bool setCellRange(int firstRow, int firstCol, int rowCount, int colCount,
+                      const std::vector<std::string>& values) override;
+
+    void setRowCount(int newRows);
+    void setColCount(int newCols);
+};
+
+#endif
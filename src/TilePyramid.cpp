@@ -0,0 +1,199 @@
+#include "TilePyramid.h"
+#include "ImageLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+TilePyramid::TilePyramid() : cacheFd(-1), cacheMap(nullptr), cacheSize(0) {}
+
+TilePyramid::~TilePyramid() {
+    release();
+}
+
+void TilePyramid::release() {
+    if (cacheMap) {
+        munmap(cacheMap, cacheSize);
+        cacheMap = nullptr;
+    }
+    if (cacheFd >= 0) {
+        close(cacheFd);
+        cacheFd = -1;
+    }
+    cacheSize = 0;
+    levels.clear();
+}
+
+bool TilePyramid::build(const ImageLoader& source) {
+    release();
+
+    const uint32_t* pixels = source.getPixelData();
+    int imgWidth = source.getWidth();
+    int imgHeight = source.getHeight();
+    if (!pixels || imgWidth <= 0 || imgHeight <= 0 || !createLevels(imgWidth, imgHeight)) {
+        return false;
+    }
+
+    for (int tileY = 0; tileY < levels[0].tilesY; tileY++) {
+        int firstRow = tileY * TILE_SIZE;
+        addStrip(&pixels[(size_t)firstRow * imgWidth], imgWidth, tileY, std::min(TILE_SIZE, imgHeight - firstRow));
+    }
+    finishBuild();
+    return true;
+}
+
+bool TilePyramid::build(const char* filepath, const std::function<bool()>& keepGoing) {
+    release();
+
+    // Bands are exactly one tile strip tall, so each is written out and dropped before the next is decoded
+    ImageLoader loader;
+    bool ok = loader.load(filepath, TILE_SIZE, [&](const uint32_t* rows, int firstRow, int rowCount) {
+        if (keepGoing && !keepGoing()) return false;
+        if (levels.empty() && !createLevels(loader.getWidth(), loader.getHeight())) return false;
+        addStrip(rows, loader.getWidth(), firstRow / TILE_SIZE, rowCount);
+        return true;
+    });
+
+    if (!ok || levels.empty()) {
+        release();
+        return false;
+    }
+    finishBuild();
+    return true;
+}
+
+bool TilePyramid::createLevels(int imgWidth, int imgHeight) {
+    // Halve until the whole level fits in a single tile
+    size_t tilePixels = (size_t)TILE_SIZE * TILE_SIZE;
+    size_t totalTiles = 0;
+    int levelWidth = imgWidth;
+    int levelHeight = imgHeight;
+    while (true) {
+        Level level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.tilesX = (levelWidth + TILE_SIZE - 1) / TILE_SIZE;
+        level.tilesY = (levelHeight + TILE_SIZE - 1) / TILE_SIZE;
+        level.offset = totalTiles * tilePixels;
+        totalTiles += (size_t)level.tilesX * level.tilesY;
+        levels.push_back(level);
+
+        if (level.tilesX == 1 && level.tilesY == 1) break;
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+    const char* tmpDir = std::getenv("TMPDIR");
+    std::string pathTemplate = std::string(tmpDir ? tmpDir : "/tmp") + "/guiframework-tiles-XXXXXX";
+    std::vector<char> path(pathTemplate.begin(), pathTemplate.end());
+    path.push_back('\0');
+
+    cacheFd = mkstemp(path.data());
+    if (cacheFd < 0) {
+        std::cerr << "Failed to create tile cache file" << std::endl;
+        levels.clear();
+        return false;
+    }
+    unlink(path.data());
+
+    cacheSize = totalTiles * tilePixels * sizeof(uint32_t);
+    if (ftruncate(cacheFd, (off_t)cacheSize) != 0) {
+        std::cerr << "Failed to size tile cache file" << std::endl;
+        release();
+        return false;
+    }
+
+    void* map = mmap(nullptr, cacheSize, PROT_READ | PROT_WRITE, MAP_SHARED, cacheFd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "Failed to map tile cache file" << std::endl;
+        cacheMap = nullptr;
+        release();
+        return false;
+    }
+    cacheMap = static_cast<uint32_t*>(map);
+    return true;
+}
+
+void TilePyramid::addStrip(const uint32_t* rows, int rowStride, int tileY, int rowCount) {
+    // The file starts zeroed, so padding is already transparent
+    const Level& base = levels[0];
+    for (int tx = 0; tx < base.tilesX; tx++) {
+        uint32_t* tile = tileAt(0, tx, tileY);
+        int srcX = tx * TILE_SIZE;
+        int copyWidth = std::min(TILE_SIZE, base.width - srcX);
+        for (int row = 0; row < rowCount; row++) {
+            std::memcpy(&tile[row * TILE_SIZE], &rows[(size_t)row * rowStride + srcX], copyWidth * sizeof(uint32_t));
+        }
+    }
+
+    // Fold the strip into each level above. A strip fills the top or bottom half of the next
+    // level's strip, which is only complete, and folded further, once its bottom half is in
+    // or there is no bottom half.
+    for (int level = 1; level < (int)levels.size(); level++) {
+        int quadY = tileY % 2;
+        tileY /= 2;
+        for (int tx = 0; tx < levels[level].tilesX; tx++) {
+            downsampleTileHalf(level, tx, tileY, quadY);
+        }
+        if (quadY == 0 && tileY * 2 + 1 < levels[level - 1].tilesY) break;
+    }
+}
+
+void TilePyramid::finishBuild() {
+    // Pyramid is complete; let the kernel write it back and evict it as it sees fit
+    mprotect(cacheMap, cacheSize, PROT_READ);
+    madvise(cacheMap, cacheSize, MADV_RANDOM);
+}
+
+uint32_t* TilePyramid::tileAt(int level, int tileX, int tileY) {
+    const Level& l = levels[level];
+    return cacheMap + l.offset + ((size_t)tileY * l.tilesX + tileX) * TILE_SIZE * TILE_SIZE;
+}
+
+const uint32_t* TilePyramid::getTile(int level, int tileX, int tileY) const {
+    if (!cacheMap || level < 0 || level >= (int)levels.size()) return nullptr;
+    const Level& l = levels[level];
+    if (tileX < 0 || tileX >= l.tilesX || tileY < 0 || tileY >= l.tilesY) return nullptr;
+    return cacheMap + l.offset + ((size_t)tileY * l.tilesX + tileX) * TILE_SIZE * TILE_SIZE;
+}
+
+void TilePyramid::downsampleTileHalf(int level, int tileX, int tileY, int quadY) {
+    const Level& parent = levels[level - 1];
+    const Level& current = levels[level];
+    uint32_t* out = tileAt(level, tileX, tileY);
+    int half = TILE_SIZE / 2;
+
+    // Each output tile is a 2x2 box filter over (up to) four parent tiles; this fills the
+    // top (quadY 0) or bottom half from the two parent tiles of one parent strip
+    for (int quadX = 0; quadX < 2; quadX++) {
+        int parentTileX = tileX * 2 + quadX;
+        int parentTileY = tileY * 2 + quadY;
+        if (parentTileX >= parent.tilesX || parentTileY >= parent.tilesY) continue;
+        const uint32_t* in = tileAt(level - 1, parentTileX, parentTileY);
+
+        int outWidth = std::min(half, current.width - (tileX * TILE_SIZE + quadX * half));
+        int outHeight = std::min(half, current.height - (tileY * TILE_SIZE + quadY * half));
+        int inWidth = std::min(TILE_SIZE, parent.width - parentTileX * TILE_SIZE);
+        int inHeight = std::min(TILE_SIZE, parent.height - parentTileY * TILE_SIZE);
+        for (int y = 0; y < outHeight; y++) {
+            // Odd-sized levels repeat their last row/column instead of averaging in padding
+            int y1 = std::min(y * 2 + 1, inHeight - 1);
+            const uint32_t* row0 = &in[(y * 2) * TILE_SIZE];
+            const uint32_t* row1 = &in[y1 * TILE_SIZE];
+            uint32_t* dst = &out[(quadY * half + y) * TILE_SIZE + quadX * half];
+            for (int x = 0; x < outWidth; x++) {
+                int x1 = std::min(x * 2 + 1, inWidth - 1);
+                uint32_t p0 = row0[x * 2], p1 = row0[x1];
+                uint32_t p2 = row1[x * 2], p3 = row1[x1];
+                uint32_t rb = (p0 & 0x00FF00FF) + (p1 & 0x00FF00FF) +
+                              (p2 & 0x00FF00FF) + (p3 & 0x00FF00FF) + 0x00020002;
+                uint32_t ag = ((p0 >> 8) & 0x00FF00FF) + ((p1 >> 8) & 0x00FF00FF) +
+                              ((p2 >> 8) & 0x00FF00FF) + ((p3 >> 8) & 0x00FF00FF) + 0x00020002;
+                dst[x] = ((rb >> 2) & 0x00FF00FF) | ((ag << 6) & 0xFF00FF00);
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+class ImageLoader;
+
+// Mip pyramid of fixed-size tiles stored in an unlinked, memory-mapped temporary file.
+// Tiles are only paged in when read, so resident memory follows what is being viewed
+// rather than the size of the image. The pyramid is built one strip of tiles at a time,
+// each strip folded into the levels above as soon as it is written.
+class TilePyramid {
+public:
+    static constexpr int TILE_SIZE = 256;
+
+    TilePyramid();
+    ~TilePyramid();
+
+    TilePyramid(const TilePyramid&) = delete;
+    TilePyramid& operator=(const TilePyramid&) = delete;
+
+    bool build(const ImageLoader& source);
+
+    // Decodes the file straight into the pyramid one tile strip at a time, so the whole
+    // image is never held in memory (see ImageLoader::load with a RowSink). keepGoing is
+    // checked before each strip and can abandon the build.
+    bool build(const char* filepath, const std::function<bool()>& keepGoing = nullptr);
+
+    void release();
+
+    int getLevelCount() const { return (int)levels.size(); }
+    int getLevelWidth(int level) const { return levels[level].width; }
+    int getLevelHeight(int level) const { return levels[level].height; }
+    int getTilesX(int level) const { return levels[level].tilesX; }
+    int getTilesY(int level) const { return levels[level].tilesY; }
+    int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+    int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+
+    // Premultiplied TILE_SIZE x TILE_SIZE pixels; edge tiles are padded with transparent pixels
+    const uint32_t* getTile(int level, int tileX, int tileY) const;
+
+private:
+    struct Level {
+        int width;
+        int height;
+        int tilesX;
+        int tilesY;
+        size_t offset;
+    };
+
+    std::vector<Level> levels;
+    int cacheFd;
+    uint32_t* cacheMap;
+    size_t cacheSize;
+
+    bool createLevels(int imgWidth, int imgHeight);
+    void addStrip(const uint32_t* rows, int rowStride, int tileY, int rowCount);
+    void finishBuild();
+    uint32_t* tileAt(int level, int tileX, int tileY);
+    void downsampleTileHalf(int level, int tileX, int tileY, int quadY);
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "TiledImageView.h"
+#include "WorkerPool.h"
+#include "PixelBlend.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+
+struct TiledImageView::BuildState {
+    std::mutex mutex;
+    std::atomic<uint64_t> generation{0};
+    TilePyramid* result = nullptr;
+    bool resultReady = false;
+};
+
+TiledImageView::TiledImageView(int x, int y, int width, int height)
+    : Widget(x, y, width, height), buildState(std::make_shared<BuildState>()),
+      pyramid(nullptr), isBuilding(false), zoom(1.0), targetZoom(1.0),
+      viewX(0.0), viewY(0.0), zoomAnchorX(0), zoomAnchorY(0), maxZoom(32.0),
+      isDragging(false), lastMouseX(0), lastMouseY(0),
+      backgroundColor(0xFF303030), borderColor(0xFF808080) {
+}
+
+TiledImageView::~TiledImageView() {
+    cancelBuild();
+    delete pyramid;
+}
+
+void TiledImageView::openImage(const std::string& filepath) {
+    clearImage();
+
+    std::shared_ptr<BuildState> state = buildState;
+    uint64_t generation = state->generation.load();
+    isBuilding = true;
+
+    WorkerPool::shared().submit([state, generation, filepath]() {
+        if (state->generation.load() != generation) return;
+
+        // Decoded a tile strip at a time, giving up as soon as another image is opened
+        TilePyramid* built = new TilePyramid();
+        if (!built->build(filepath.c_str(), [&state, generation]() { return state->generation.load() == generation; })) {
+            delete built;
+            built = nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->generation.load() != generation) {
+            delete built;
+            return;
+        }
+        state->result = built;
+        state->resultReady = true;
+    });
+}
+
+void TiledImageView::cancelBuild() {
+    std::lock_guard<std::mutex> lock(buildState->mutex);
+    buildState->generation++;
+    delete buildState->result;
+    buildState->result = nullptr;
+    buildState->resultReady = false;
+    isBuilding = false;
+}
+
+void TiledImageView::clearImage() {
+    cancelBuild();
+    delete pyramid;
+    pyramid = nullptr;
+    isDragging = false;
+}
+
+void TiledImageView::pollBuild() {
+    if (!isBuilding) return;
+
+    TilePyramid* built = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(buildState->mutex);
+        if (!buildState->resultReady) return;
+        built = buildState->result;
+        buildState->result = nullptr;
+        buildState->resultReady = false;
+    }
+
+    isBuilding = false;
+    pyramid = built;
+    if (pyramid) {
+        zoomToFit();
+    }
+}
+
+double TiledImageView::getFitZoom() const {
+    if (!pyramid) return 1.0;
+    double fitX = (double)getContentWidth() / pyramid->getWidth();
+    double fitY = (double)getContentHeight() / pyramid->getHeight();
+    return std::min(fitX, fitY);
+}
+
+void TiledImageView::zoomToFit() {
+    zoom = getFitZoom();
+    targetZoom = zoom;
+    clampView();
+}
+
+void TiledImageView::setZoom(double newZoom) {
+    double minZoom = std::min(getFitZoom(), 1.0);
+    targetZoom = std::max(minZoom, std::min(newZoom, maxZoom));
+    zoomAnchorX = getContentWidth() / 2;
+    zoomAnchorY = getContentHeight() / 2;
+}
+
+void TiledImageView::applyZoom(double newZoom, int anchorX, int anchorY) {
+    // Keep the image point under the anchor fixed on screen
+    double imageX = viewX + anchorX / zoom;
+    double imageY = viewY + anchorY / zoom;
+    zoom = newZoom;
+    viewX = imageX - anchorX / zoom;
+    viewY = imageY - anchorY / zoom;
+    clampView();
+}
+
+void TiledImageView::clampView() {
+    if (!pyramid) return;
+
+    double visibleWidth = getContentWidth() / zoom;
+    double visibleHeight = getContentHeight() / zoom;
+    double imageWidth = pyramid->getWidth();
+    double imageHeight = pyramid->getHeight();
+
+    if (visibleWidth >= imageWidth) {
+        viewX = (imageWidth - visibleWidth) / 2.0;
+    } else {
+        viewX = std::max(0.0, std::min(viewX, imageWidth - visibleWidth));
+    }
+
+    if (visibleHeight >= imageHeight) {
+        viewY = (imageHeight - visibleHeight) / 2.0;
+    } else {
+        viewY = std::max(0.0, std::min(viewY, imageHeight - visibleHeight));
+    }
+}
+
+void TiledImageView::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
+    int absX = getAbsoluteX();
+    int absY = getAbsoluteY();
+    int endX = std::min(absX + width, bufferWidth);
+    int endY = std::min(absY + height, bufferHeight);
+
+    pollBuild();
+
+    for (int py = std::max(absY, 0); py < endY; py++) {
+        for (int px = std::max(absX, 0); px < endX; px++) {
+            bool isBorder = py == absY || py == absY + height - 1 || px == absX || px == absX + width - 1;
+            buffer[py * bufferWidth + px] = isBorder ? borderColor : backgroundColor;
+        }
+    }
+
+    if (!pyramid) {
+        if (isBuilding && fontRenderer) {
+            std::string label = "Loading...";
+            int textX = absX + (width - fontRenderer->getTextWidth(label)) / 2;
+            int textY = absY + (height + fontRenderer->getTextHeight()) / 2;
+            fontRenderer->drawText(buffer, bufferWidth, bufferHeight, label, textX, textY, 0xFFC0C0C0);
+        }
+        return;
+    }
+
+    // Ease towards the wheel-requested zoom a fraction per frame
+    if (zoom != targetZoom) {
+        double next = zoom + (targetZoom - zoom) * 0.35;
+        if (std::fabs(next / targetZoom - 1.0) < 0.002) {
+            next = targetZoom;
+        }
+        applyZoom(next, zoomAnchorX, zoomAnchorY);
+    }
+
+    // Coarsest level that still has at least one texel per screen pixel
+    int level = 0;
+    while (level + 1 < pyramid->getLevelCount() && zoom * (double)(1 << (level + 1)) <= 1.0) {
+        level++;
+    }
+    double levelScale = 1.0 / (double)(1 << level);
+    int levelWidth = pyramid->getLevelWidth(level);
+    int levelHeight = pyramid->getLevelHeight(level);
+    const int tileSize = TilePyramid::TILE_SIZE;
+
+    int contentX = absX + 1;
+    int contentY = absY + 1;
+    int startX = std::max(contentX, 0);
+    int startY = std::max(contentY, 0);
+    int stopX = std::min(contentX + getContentWidth(), bufferWidth);
+    int stopY = std::min(contentY + getContentHeight(), bufferHeight);
+    if (startX >= stopX || startY >= stopY) return;
+
+    columnSource.resize(stopX - startX);
+    for (int px = startX; px < stopX; px++) {
+        double imageX = viewX + (px - contentX + 0.5) / zoom;
+        int levelX = (int)std::floor(imageX * levelScale);
+        columnSource[px - startX] = (levelX >= 0 && levelX < levelWidth) ? levelX : -1;
+    }
+
+    for (int py = startY; py < stopY; py++) {
+        double imageY = viewY + (py - contentY + 0.5) / zoom;
+        int levelY = (int)std::floor(imageY * levelScale);
+        if (levelY < 0 || levelY >= levelHeight) continue;
+
+        int tileY = levelY / tileSize;
+        int rowInTile = levelY % tileSize;
+        uint32_t* dst = &buffer[py * bufferWidth];
+        int currentTileX = -1;
+        const uint32_t* tileRow = nullptr;
+
+        for (int px = startX; px < stopX; px++) {
+            int levelX = columnSource[px - startX];
+            if (levelX < 0) continue;
+
+            int tileX = levelX / tileSize;
+            if (tileX != currentTileX) {
+                currentTileX = tileX;
+                tileRow = pyramid->getTile(level, tileX, tileY) + rowInTile * tileSize;
+            }
+            dst[px] = blendPremultiplied(tileRow[levelX % tileSize], dst[px]);
+        }
+    }
+}
+
+void TiledImageView::handleMouseButton(int mouseX, int mouseY, bool isPressed) {
+    if (isPressed) {
+        if (pyramid && containsPoint(mouseX, mouseY)) {
+            isDragging = true;
+            lastMouseX = mouseX;
+            lastMouseY = mouseY;
+        }
+    } else {
+        isDragging = false;
+    }
+}
+
+void TiledImageView::handleMouseMove(int mouseX, int mouseY) {
+    if (!isDragging || !pyramid) return;
+
+    viewX -= (mouseX - lastMouseX) / zoom;
+    viewY -= (mouseY - lastMouseY) / zoom;
+    lastMouseX = mouseX;
+    lastMouseY = mouseY;
+    clampView();
+}
+
+void TiledImageView::handleMouseWheel(int mouseX, int mouseY, float delta) {
+    if (!pyramid) return;
+
+    double minZoom = std::min(getFitZoom(), 1.0);
+    targetZoom = std::max(minZoom, std::min(targetZoom * std::pow(1.25, delta), maxZoom));
+    zoomAnchorX = mouseX - getAbsoluteX() - 1;
+    zoomAnchorY = mouseY - getAbsoluteY() - 1;
+}
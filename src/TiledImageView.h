@@ -0,0 +1,75 @@
+#ifndef TILEDIMAGEVIEW_H
+#define TILEDIMAGEVIEW_H
+
+#include "Widget.h"
+#include "TilePyramid.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+// Zoomable, pannable viewer for images too large to scale in memory. The image is
+// decoded in the background into a TilePyramid; drawing samples only the tiles that
+// cover the viewport at the mip level matching the current zoom.
+class TiledImageView : public Widget {
+private:
+    struct BuildState;
+
+    std::shared_ptr<BuildState> buildState;
+    TilePyramid* pyramid;
+    bool isBuilding;
+
+    // View transform: screen = (image - view) * zoom, relative to the content area
+    double zoom;
+    double targetZoom;
+    double viewX;
+    double viewY;
+    int zoomAnchorX;
+    int zoomAnchorY;
+    double maxZoom;
+
+    bool isDragging;
+    int lastMouseX;
+    int lastMouseY;
+
+    uint32_t backgroundColor;
+    uint32_t borderColor;
+
+    // Per-frame scratch: level-space column of each screen column
+    std::vector<int> columnSource;
+
+    void pollBuild();
+    void cancelBuild();
+    void applyZoom(double newZoom, int anchorX, int anchorY);
+    void clampView();
+    double getFitZoom() const;
+    int getContentWidth() const { return width - 2; }
+    int getContentHeight() const { return height - 2; }
+
+public:
+    TiledImageView(int x, int y, int width, int height);
+    ~TiledImageView();
+
+    void draw(uint32_t* buffer, int bufferWidth, int bufferHeight) override;
+    void handleMouseButton(int mouseX, int mouseY, bool isPressed) override;
+    void handleMouseMove(int mouseX, int mouseY) override;
+    void handleMouseWheel(int mouseX, int mouseY, float delta) override;
+
+    // Decodes and tiles the image on the shared worker pool; replaces any pending open
+    void openImage(const std::string& filepath);
+    void clearImage();
+
+    void zoomToFit();
+    void setZoom(double newZoom);
+    void setMaxZoom(double newMaxZoom) { maxZoom = newMaxZoom; }
+    double getZoom() const { return zoom; }
+
+    void setBackgroundColor(uint32_t color) { backgroundColor = color; }
+    void setBorderColor(uint32_t color) { borderColor = color; }
+
+    bool isLoading() const { return isBuilding; }
+    bool hasImage() const { return pyramid != nullptr; }
+    int getImageWidth() const { return pyramid ? pyramid->getWidth() : 0; }
+    int getImageHeight() const { return pyramid ? pyramid->getHeight() : 0; }
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "TimeSeriesPlot.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+TimeSeriesPlot::TimeSeriesPlot(int x, int y, int width, int height, size_t capacity)
+    : Canvas(x, y, width, height),
+      totalSamples(0),
+      samplesPerColumn(1.0),
+      followLatest(true),
+      firstColumn(0),
+      yMin(-1.0f),
+      yMax(1.0f),
+      traceColor(0xFF2060C0),
+      plotBackgroundColor(0xFFFFFFFF),
+      renderValid(false),
+      renderedFirstColumn(0),
+      renderedTotal(0),
+      renderedOldest(0) {
+
+    // Build levels while a block still fits the buffer, then round the capacity up to
+    // whole top-level blocks so no block straddles the ring's wrap point
+    size_t blockSize = (size_t)1 << BLOCK_SHIFT;
+    int levelCount = 1;
+    while ((blockSize << BLOCK_SHIFT) <= capacity) {
+        blockSize <<= BLOCK_SHIFT;
+        levelCount++;
+    }
+    this->capacity = (std::max(capacity, (size_t)1) + blockSize - 1) / blockSize * blockSize;
+
+    samples.assign(this->capacity, 0.0f);
+    levels.resize(levelCount);
+    for (int level = 0; level < levelCount; level++) {
+        levels[level].resize(this->capacity >> (BLOCK_SHIFT * (level + 1)));
+    }
+}
+
+void TimeSeriesPlot::append(float value) {
+    uint64_t index = totalSamples;
+    samples[index % capacity] = value;
+
+    // Level 0 blocks are updated per sample; each higher block is folded in once its child completes
+    ValueRange& block = levels[0][(index >> BLOCK_SHIFT) % levels[0].size()];
+    if ((index & ((1 << BLOCK_SHIFT) - 1)) == 0) {
+        block.minValue = value;
+        block.maxValue = value;
+    } else {
+        block.minValue = std::min(block.minValue, value);
+        block.maxValue = std::max(block.maxValue, value);
+    }
+
+    for (size_t level = 0; level + 1 < levels.size(); level++) {
+        int childShift = BLOCK_SHIFT * (level + 1);
+        if (((index + 1) & (((uint64_t)1 << childShift) - 1)) != 0) break;
+
+        const ValueRange& child = levels[level][(index >> childShift) % levels[level].size()];
+        ValueRange& parent = levels[level + 1][(index >> (childShift + BLOCK_SHIFT)) % levels[level + 1].size()];
+        if (((index >> childShift) & ((1 << BLOCK_SHIFT) - 1)) == 0) {
+            parent = child;
+        } else {
+            parent.minValue = std::min(parent.minValue, child.minValue);
+            parent.maxValue = std::max(parent.maxValue, child.maxValue);
+        }
+    }
+
+    totalSamples++;
+}
+
+void TimeSeriesPlot::append(const float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        append(values[i]);
+    }
+}
+
+void TimeSeriesPlot::clearSamples() {
+    totalSamples = 0;
+    firstColumn = 0;
+    renderValid = false;
+}
+
+void TimeSeriesPlot::setSamplesPerColumn(double samplesPerColumn) {
+    if (!(samplesPerColumn > 0.0)) return;
+
+    // Keep the first visible sample in place when not following
+    double firstSample = firstColumn * this->samplesPerColumn;
+    this->samplesPerColumn = samplesPerColumn;
+    firstColumn = (int64_t)std::floor(firstSample / samplesPerColumn);
+    renderValid = false;
+}
+
+void TimeSeriesPlot::setFollowLatest(bool follow) {
+    if (followLatest == follow) return;
+    if (!follow) {
+        firstColumn = getLatestFirstColumn();
+    }
+    followLatest = follow;
+}
+
+void TimeSeriesPlot::scrollToSample(uint64_t firstSample) {
+    followLatest = false;
+    firstColumn = (int64_t)std::floor(firstSample / samplesPerColumn);
+}
+
+void TimeSeriesPlot::setYRange(float minValue, float maxValue) {
+    if (!(maxValue > minValue)) return;
+    yMin = minValue;
+    yMax = maxValue;
+    renderValid = false;
+}
+
+void TimeSeriesPlot::setTraceColor(uint32_t color) {
+    traceColor = color;
+    renderValid = false;
+}
+
+void TimeSeriesPlot::setPlotBackgroundColor(uint32_t color) {
+    plotBackgroundColor = color;
+    renderValid = false;
+}
+
+uint64_t TimeSeriesPlot::getOldestSample() const {
+    return totalSamples > capacity ? totalSamples - capacity : 0;
+}
+
+float TimeSeriesPlot::interpolateAt(double position) const {
+    uint64_t index = (uint64_t)position;
+    if (index + 1 >= totalSamples) return sampleAt(totalSamples - 1);
+    float fraction = (float)(position - (double)index);
+    float a = sampleAt(index);
+    float b = sampleAt(index + 1);
+    return a + (b - a) * fraction;
+}
+
+void TimeSeriesPlot::queryRange(uint64_t first, uint64_t last, ValueRange& range) const {
+    // Cover [first, last) with the largest aligned complete blocks, raw samples at the edges
+    uint64_t i = first;
+    while (i < last) {
+        int level = (int)levels.size() - 1;
+        uint64_t blockSize = 0;
+        for (; level >= 0; level--) {
+            blockSize = (uint64_t)1 << (BLOCK_SHIFT * (level + 1));
+            if ((i & (blockSize - 1)) == 0 && i + blockSize <= last) break;
+        }
+
+        if (level < 0) {
+            float value = sampleAt(i);
+            range.minValue = std::min(range.minValue, value);
+            range.maxValue = std::max(range.maxValue, value);
+            i++;
+        } else {
+            const ValueRange& block = levels[level][(i >> (BLOCK_SHIFT * (level + 1))) % levels[level].size()];
+            range.minValue = std::min(range.minValue, block.minValue);
+            range.maxValue = std::max(range.maxValue, block.maxValue);
+            i += blockSize;
+        }
+    }
+}
+
+int64_t TimeSeriesPlot::getLatestFirstColumn() const {
+    int64_t lastColumn = totalSamples > 0 ? (int64_t)std::floor((totalSamples - 1) / samplesPerColumn) : 0;
+    return lastColumn - getCanvasWidth() + 1;
+}
+
+void TimeSeriesPlot::renderColumns(int firstX, int lastX, int64_t firstVisibleColumn) {
+    int plotHeight = getCanvasHeight();
+    fillRect(firstX, 0, lastX - firstX + 1, plotHeight, plotBackgroundColor);
+    if (totalSamples == 0) return;
+
+    double oldest = (double)getOldestSample();
+    double newest = (double)(totalSamples - 1);
+    float scale = (plotHeight - 1) / (yMax - yMin);
+
+    for (int x = firstX; x <= lastX; x++) {
+        // Column covers [start, end]; the interpolated ends join it to its neighbours
+        double start = (firstVisibleColumn + x) * samplesPerColumn;
+        double end = (firstVisibleColumn + x + 1) * samplesPerColumn;
+        if (end < oldest || start > newest) continue;
+        start = std::max(start, oldest);
+        end = std::min(end, newest);
+
+        ValueRange range;
+        range.minValue = std::min(interpolateAt(start), interpolateAt(end));
+        range.maxValue = std::max(interpolateAt(start), interpolateAt(end));
+        queryRange((uint64_t)std::ceil(start), (uint64_t)std::floor(end) + 1, range);
+
+        int top = (int)std::lround((yMax - range.maxValue) * scale);
+        int bottom = (int)std::lround((yMax - range.minValue) * scale);
+        top = std::max(top, 0);
+        bottom = std::min(bottom, plotHeight - 1);
+        if (top <= bottom) {
+            fillRect(x, top, 1, bottom - top + 1, traceColor);
+        }
+    }
+}
+
+void TimeSeriesPlot::updatePlot() {
+    int plotWidth = getCanvasWidth();
+    int plotHeight = getCanvasHeight();
+    int64_t first = followLatest ? getLatestFirstColumn() : firstColumn;
+    uint64_t oldest = getOldestSample();
+
+    if (renderValid && first == renderedFirstColumn && totalSamples == renderedTotal) return;
+
+    int64_t shift = first - renderedFirstColumn;
+    bool evictedVisible = oldest != renderedOldest && first * samplesPerColumn < oldest;
+    if (!renderValid || shift < 0 || shift >= plotWidth || totalSamples < renderedTotal || evictedVisible) {
+        renderColumns(0, plotWidth - 1, first);
+    } else {
+        // Scroll the existing columns left, then render the ones that are new or were incomplete
+        if (shift > 0) {
+            uint32_t* pixels = getBuffer();
+            int stride = getStride();
+            for (int y = 0; y < plotHeight; y++) {
+                std::memmove(pixels + y * stride, pixels + y * stride + shift,
+                             (plotWidth - shift) * sizeof(uint32_t));
+            }
+        }
+
+        int64_t staleColumn = renderedTotal > 0
+            ? (int64_t)std::floor((renderedTotal - 1) / samplesPerColumn) - 1
+            : first;
+        int firstX = (int)std::max<int64_t>(staleColumn - first, 0);
+        firstX = std::min<int>(firstX, plotWidth - (int)shift);
+        renderColumns(firstX, plotWidth - 1, first);
+    }
+
+    renderValid = true;
+    renderedFirstColumn = first;
+    renderedTotal = totalSamples;
+    renderedOldest = oldest;
+}
+
+void TimeSeriesPlot::setSize(int newWidth, int newHeight) {
+    Canvas::setSize(newWidth, newHeight);
+    renderValid = false;
+}
+
+void TimeSeriesPlot::draw(uint32_t* buffer, int bufferWidth, int bufferHeight) {
+    updatePlot();
+    Canvas::draw(buffer, bufferWidth, bufferHeight);
+}
@@ -0,0 +1,77 @@
+#ifndef TIMESERIESPLOT_H
+#define TIMESERIESPLOT_H
+
+#include "Canvas.h"
+#include <vector>
+#include <cstdint>
+
+// Line plot of a sample stream far longer than the plot is wide. Samples live in a ring
+// buffer with a min/max pyramid over it, so every pixel column is drawn as one vertical
+// span whatever the zoom, and the cost of a redraw depends on the width, not the sample
+// count. When following the newest samples, only the columns scrolled in are rendered.
+class TimeSeriesPlot : public Canvas {
+private:
+    // Each pyramid level groups 16 entries of the level below; level 0 blocks are 16 samples
+    static constexpr int BLOCK_SHIFT = 4;
+
+    struct ValueRange {
+        float minValue;
+        float maxValue;
+    };
+
+    std::vector<float> samples;
+    size_t capacity;
+    uint64_t totalSamples;
+    std::vector<std::vector<ValueRange>> levels;
+
+    double samplesPerColumn;
+    bool followLatest;
+    int64_t firstColumn;
+    float yMin;
+    float yMax;
+    uint32_t traceColor;
+    uint32_t plotBackgroundColor;
+
+    // What the canvas currently shows
+    bool renderValid;
+    int64_t renderedFirstColumn;
+    uint64_t renderedTotal;
+    uint64_t renderedOldest;
+
+    uint64_t getOldestSample() const;
+    float sampleAt(uint64_t index) const { return samples[index % capacity]; }
+    float interpolateAt(double position) const;
+    void queryRange(uint64_t first, uint64_t last, ValueRange& range) const;
+    int64_t getLatestFirstColumn() const;
+    void renderColumns(int firstX, int lastX, int64_t firstVisibleColumn);
+    void updatePlot();
+
+public:
+    TimeSeriesPlot(int x, int y, int width, int height, size_t capacity = 1 << 20);
+
+    void draw(uint32_t* buffer, int bufferWidth, int bufferHeight) override;
+    void setSize(int newWidth, int newHeight) override;
+
+    // Appends overwrite the oldest samples once the ring buffer is full
+    void append(float value);
+    void append(const float* values, size_t count);
+    void clearSamples();
+
+    // Horizontal zoom; fractional values zoom in past one sample per column
+    void setSamplesPerColumn(double samplesPerColumn);
+    // Keep the newest sample at the right edge
+    void setFollowLatest(bool follow);
+    // Stops following and shows samples from firstSample onwards
+    void scrollToSample(uint64_t firstSample);
+    void setYRange(float minValue, float maxValue);
+
+    void setTraceColor(uint32_t color);
+    void setPlotBackgroundColor(uint32_t color);
+
+    uint64_t getSampleCount() const { return totalSamples; }
+    size_t getCapacity() const { return capacity; }
+    double getSamplesPerColumn() const { return samplesPerColumn; }
+    bool getFollowLatest() const { return followLatest; }
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Widget.h"
 
+int Widget::keyModifiers = 0;
+
 Widget::Widget(int x, int y, int width, int height)
     : x(x), y(y), width(width), height(height), parent(nullptr), fontRenderer(nullptr) {
 }
@@ -30,6 +32,12 @@ void Widget::handleMouseButton(int mouseX, int mouseY, bool isPressed) {
     (void)isPressed;
 }
 
+void Widget::handleMouseWheel(int mouseX, int mouseY, float delta) {
+    (void)mouseX;
+    (void)mouseY;
+    (void)delta;
+}
+
 void Widget::handleChar(unsigned int charCode) {
     (void)charCode;
 }
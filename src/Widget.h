@@ -10,6 +10,9 @@ protected:
     Widget* parent;
     FontRenderer* fontRenderer;
 
+    // Modifier keys (KB_MOD_* bits) held during the input event being handled
+    static int keyModifiers;
+
 public:
     Widget(int x, int y, int width, int height);
     virtual ~Widget();
@@ -19,6 +22,7 @@ public:
     virtual void checkHover(int mouseX, int mouseY);
     virtual void handleMouseMove(int mouseX, int mouseY);
     virtual void handleMouseButton(int mouseX, int mouseY, bool isPressed);
+    virtual void handleMouseWheel(int mouseX, int mouseY, float delta);
     virtual void handleChar(unsigned int charCode);
     virtual void handleKey(int key, bool isPressed);
 
@@ -42,6 +46,10 @@ public:
     Widget* getParent() const { return parent; }
 
     bool containsPoint(int pointX, int pointY) const;
+
+    // Set by the framework before it dispatches each key and mouse button event
+    static void setKeyModifiers(int modifiers) { keyModifiers = modifiers; }
+    static int getKeyModifiers() { return keyModifiers; }
 };
 
 #endif
@@ -0,0 +1,98 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threadCount) : stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency();
+        if (threadCount < 2) threadCount = 2;
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobAvailable.notify_all();
+
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& job) {
+    if (count <= 0) return;
+
+    struct Batch {
+        std::atomic<int> next{0};
+        int count = 0;
+        int finished = 0;
+        const std::function<void(int)>* job = nullptr;
+        std::mutex mutex;
+        std::condition_variable done;
+
+        void runJobs() {
+            int completed = 0;
+            int index;
+            while ((index = next.fetch_add(1)) < count) {
+                (*job)(index);
+                completed++;
+            }
+            if (completed == 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            finished += completed;
+            if (finished == count) {
+                done.notify_all();
+            }
+        }
+    };
+
+    // Helpers that start after every index is taken only touch the shared batch
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->job = &job;
+
+    int helpers = std::min(getThreadCount(), count - 1);
+    for (int i = 0; i < helpers; i++) {
+        submit([batch]() { batch->runJobs(); });
+    }
+    batch->runJobs();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait(lock, [&batch] { return batch->finished == batch->count; });
+}
+
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
@@ -0,0 +1,42 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+class WorkerPool {
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    bool stopping;
+
+    void workerLoop();
+
+public:
+    explicit WorkerPool(int threadCount = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Jobs run on a worker thread in submission order; they must not touch widgets directly
+    void submit(std::function<void()> job);
+    int getThreadCount() const { return (int)threads.size(); }
+
+    // Runs job(0) .. job(count - 1) across the pool and waits for all of them. The calling
+    // thread takes indices too, so this still finishes when every worker is busy.
+    void parallelFor(int count, const std::function<void(int)>& job);
+
+    // Process-wide pool shared by background image decoding and other framework jobs
+    static WorkerPool& shared();
+};
+
+#endif